@@ -0,0 +1,167 @@
+/**
+ ******************************************************************************
+ * @file    kalman_bench.cpp
+ * @brief   Benchmark of the sparse cEKF step against the dense one.
+ *          Both filters run on the same IMU sequence, every step is checked
+ *          to give the same quaternion and P to the bit.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Host, next to Eigen (../Eigen like the filters):
+ *      g++ -std=c++17 -O2 -ffp-contract=off kalman_bench.cpp -o kalman_bench && ./kalman_bench
+ *
+ * Cortex-M: add this file to the firmware with -DKALMAN_BENCH_NO_MAIN and
+ * -ffp-contract=off, so both modes round alike on the FPU's fused multiply-add,
+ * call KalmanBenchRun() once and read kalman_bench_result in the debugger. Time
+ * is counted in cycles by DWT->CYCCNT there, in ns on the host. The best
+ * step of each mode is kept, so interrupts or a busy host only add noise
+ * to the worst case.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "libkalman-i-imuekf-1.0.hpp"
+
+#if defined(__arm__)
+#define KALMAN_BENCH_DEMCR   (*(volatile uint32_t *) 0xE000EDFCu)
+#define KALMAN_BENCH_DWTCTRL (*(volatile uint32_t *) 0xE0001000u)
+#define KALMAN_BENCH_CYCCNT  (*(volatile uint32_t *) 0xE0001004u)
+#else
+#include <chrono>
+#include <cstdio>
+#endif
+
+struct KalmanBenchResult {
+    uint32_t steps;
+    uint32_t mismatch;      // Steps whose quaternion or P differ between the modes
+    uint32_t dense_best;    // Cycles on Cortex-M, ns on host
+    uint32_t sparse_best;
+    uint32_t dense_sum;
+    uint32_t sparse_sum;
+};
+
+KalmanBenchResult kalman_bench_result;
+
+namespace {
+
+    constexpr uint32_t kSteps = 4000;
+    constexpr float kDt = 0.001f;
+
+    uint32_t Now() {
+#if defined(__arm__)
+        return KALMAN_BENCH_CYCCNT;
+#else
+        using clock = std::chrono::steady_clock;
+        return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Slow tumbling with noise, so the filter leaves the static case and P keeps changing
+    void Sample(uint32_t i, uint32_t &seed, float *accel, float *gyro) {
+        float t = (float) i * kDt;
+        seed = seed * 1664525u + 1013904223u;
+        float noise = (float) (seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+        float roll = 0.6f * sinf(1.3f * t);
+        float pitch = 0.4f * sinf(0.7f * t + 1.0f);
+        gyro[0] = 0.6f * 1.3f * cosf(1.3f * t) + 0.01f * noise;
+        gyro[1] = 0.4f * 0.7f * cosf(0.7f * t + 1.0f) - 0.01f * noise;
+        gyro[2] = 0.05f + 0.005f * noise;
+        accel[0] = -9.8f * sinf(pitch) + 0.05f * noise;
+        accel[1] = 9.8f * cosf(pitch) * sinf(roll) - 0.05f * noise;
+        accel[2] = 9.8f * cosf(pitch) * cosf(roll) + 0.02f * noise;
+    }
+
+    uint32_t Step(EKF::cEKF &ekf, const float *accel, const float *gyro) {
+        uint32_t t0 = Now();
+        ekf.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], kDt);
+        return Now() - t0;
+    }
+
+}  // namespace
+
+void KalmanBenchRun() {
+#if defined(__arm__)
+    KALMAN_BENCH_DEMCR |= 1u << 24;     // TRCENA
+    KALMAN_BENCH_CYCCNT = 0;
+    KALMAN_BENCH_DWTCTRL |= 1u;         // CYCCNTENA
+#endif
+    static EKF::cEKF dense(10, 0.001, 10000000, 0.9996);
+    static EKF::cEKF sparse(10, 0.001, 10000000, 0.9996);
+    dense.ResetEKF();
+    sparse.ResetEKF();
+    sparse.SetSparseUpdate(1);
+    KalmanBenchResult &res = kalman_bench_result;
+    memset(&res, 0, sizeof(res));
+    res.dense_best = UINT32_MAX;
+    res.sparse_best = UINT32_MAX;
+    uint32_t seed = 1;
+    float accel[3], gyro[3];
+    float q_dense[4], q_sparse[4];
+    for (uint32_t i = 0; i < kSteps; i++) {
+        Sample(i, seed, accel, gyro);
+        // Alternate the order so neither mode always runs with warm caches
+        uint32_t t_dense, t_sparse;
+        if (i & 1u) {
+            t_sparse = Step(sparse, accel, gyro);
+            t_dense = Step(dense, accel, gyro);
+        } else {
+            t_dense = Step(dense, accel, gyro);
+            t_sparse = Step(sparse, accel, gyro);
+        }
+        res.dense_best = t_dense < res.dense_best ? t_dense : res.dense_best;
+        res.sparse_best = t_sparse < res.sparse_best ? t_sparse : res.sparse_best;
+        res.dense_sum += t_dense;
+        res.sparse_sum += t_sparse;
+        dense.GetQuaternion(q_dense);
+        sparse.GetQuaternion(q_sparse);
+        if (memcmp(q_dense, q_sparse, sizeof(q_dense)) != 0 ||
+            memcmp(dense.GetCovariance().data(), sparse.GetCovariance().data(),
+                   sizeof(float) * dense.GetCovariance().size()) != 0) {
+            res.mismatch++;
+        }
+        res.steps++;
+    }
+}
+
+#ifndef KALMAN_BENCH_NO_MAIN
+#if defined(__arm__)
+int main() {
+    KalmanBenchRun();
+    while (1) {}
+}
+#else
+int main() {
+    // Best of a few runs, the first one also warms up
+    KalmanBenchResult best = {};
+    for (uint32_t r = 0; r < 20; r++) {
+        KalmanBenchRun();
+        const KalmanBenchResult &res = kalman_bench_result;
+        if (r == 0 || res.dense_sum < best.dense_sum) {
+            best.dense_sum = res.dense_sum;
+            best.dense_best = res.dense_best;
+        }
+        if (r == 0 || res.sparse_sum < best.sparse_sum) {
+            best.sparse_sum = res.sparse_sum;
+            best.sparse_best = res.sparse_best;
+        }
+        best.steps = res.steps;
+        best.mismatch += res.mismatch;
+    }
+    printf("steps %u, mismatching steps %u\n", (unsigned) best.steps, (unsigned) best.mismatch);
+    printf("dense  %.1f ns/step mean, %u ns best\n", (double) best.dense_sum / best.steps,
+           (unsigned) best.dense_best);
+    printf("sparse %.1f ns/step mean, %u ns best\n", (double) best.sparse_sum / best.steps,
+           (unsigned) best.sparse_best);
+    return best.mismatch != 0;
+}
+#endif
+#endif
@@ -0,0 +1,276 @@
+/**
+ ******************************************************************************
+ * @file    kalman_replay.cpp
+ * @brief   Host replay of recorded IMU logs through EKF::cEKF.
+ *          The log is memory mapped and fed to the filter in batches,
+ *          quaternions and gyro biases go to the output file.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Build next to Eigen (../Eigen like the filters), POSIX host:
+ *      g++ -std=c++17 -O2 -march=native kalman_replay.cpp -o kalman_replay
+ *      ./kalman_replay [options] log.bin|log.csv out.bin|out.csv
+ *
+ * Input, one sample per record, accel in m/s^2, gyro in rad/s, dt in s:
+ *      .csv    ax,ay,az,gx,gy,gz,dt per line, lines not starting with a
+ *              number (header, comments) are skipped
+ *      other   7 little endian float32 per record in the same order
+ * Output, one record per sample:
+ *      .csv    q0,q1,q2,q3,bx,by,bz
+ *      other   the same 7 values as float32
+ *
+ * Options:
+ *      -q <v>      process noise of the quaternion     (10)
+ *      -b <v>      process noise of the gyro bias      (0.001)
+ *      -r <v>      accelerometer noise                 (10000000)
+ *      -l <v>      fading coefficient                  (0.9996)
+ *      -m <mode>   dense, sparse or sequential         (sparse)
+ *      -s <n>      write a synthetic 1 kHz log of n samples to the input
+ *                  path first, e.g. -s 3600000 for one hour
+ *
+ * The filter time and the total time are reported separately, samples per
+ * second of the filter is what the tuning loop cares about.
+ */
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "libkalman-i-imuekf-1.0.hpp"
+
+namespace {
+
+    constexpr uint32_t kFields = 7;         // Values per input and output record
+    constexpr uint32_t kBatch = 4096;       // Samples per call of UpdateBatch()
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::time_point t0, Clock::time_point t1) {
+        return std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    bool EndsWith(const char *str, const char *suffix) {
+        size_t n = strlen(str);
+        size_t m = strlen(suffix);
+        return n >= m && strcmp(str + n - m, suffix) == 0;
+    }
+
+    // Read only mapping of a whole file
+    class MappedFile {
+    public:
+        const char *data = nullptr;
+        size_t size = 0;
+
+        explicit MappedFile(const char *path) {
+            int fd = open(path, O_RDONLY);
+            if (fd < 0) { return; }
+            struct stat st{};
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    madvise(p, (size_t) st.st_size, MADV_SEQUENTIAL);
+                    data = static_cast<const char *>(p);
+                    size = (size_t) st.st_size;
+                }
+            }
+            close(fd);
+        }
+
+        ~MappedFile() {
+            if (data != nullptr) { munmap(const_cast<char *>(data), size); }
+        }
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+    };
+
+    // Next batch of samples from a CSV log, pos is advanced past the lines read
+    uint32_t ParseCsv(const char *&pos, const char *end, float *imu, uint32_t max) {
+        uint32_t n = 0;
+        while (pos < end && n < max) {
+            const char *eol = static_cast<const char *>(memchr(pos, '\n', (size_t) (end - pos)));
+            if (eol == nullptr) { eol = end; }
+            const char *p = pos;
+            pos = eol + (eol < end);
+            while (p < eol && (*p == ' ' || *p == '\t')) { p++; }
+            if (p == eol || !(*p == '-' || *p == '+' || *p == '.' || (*p >= '0' && *p <= '9'))) { continue; }
+            float *rec = imu + n * kFields;
+            uint32_t f = 0;
+            for (; f < kFields && p < eol; f++) {
+                if (*p == '+') { p++; }
+                auto res = std::from_chars(p, eol, rec[f]);
+                if (res.ec != std::errc()) { break; }
+                p = res.ptr;
+                while (p < eol && (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r')) { p++; }
+            }
+            if (f == kFields) { n++; }
+        }
+        return n;
+    }
+
+    // Shortest round trip text of n records
+    void WriteCsv(FILE *fp, const float *out, uint32_t n, std::vector<char> &buf) {
+        buf.resize((size_t) n * kFields * 16);
+        char *p = buf.data();
+        for (uint32_t i = 0; i < n * kFields; i++) {
+            p = std::to_chars(p, p + 15, out[i]).ptr;
+            *p++ = (i % kFields == kFields - 1) ? '\n' : ',';
+        }
+        fwrite(buf.data(), 1, (size_t) (p - buf.data()), fp);
+    }
+
+    // Tumbling at up to a few rad/s with accelerometer and gyro noise, 1 kHz
+    bool WriteSynthetic(const char *path, uint32_t count) {
+        FILE *fp = fopen(path, "wb");
+        if (fp == nullptr) { return false; }
+        bool csv = EndsWith(path, ".csv");
+        std::vector<float> rec((size_t) kBatch * kFields);
+        std::vector<char> text;
+        uint32_t seed = 1;
+        for (uint32_t base = 0; base < count; base += kBatch) {
+            uint32_t n = count - base < kBatch ? count - base : kBatch;
+            for (uint32_t i = 0; i < n; i++) {
+                float t = (float) (base + i) * 0.001f;
+                float noise[3];
+                for (float &v: noise) {
+                    seed = seed * 1664525u + 1013904223u;
+                    v = (float) (seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+                }
+                float roll = 0.6f * sinf(1.3f * t);
+                float pitch = 0.4f * sinf(0.7f * t + 1.0f);
+                float *r = &rec[(size_t) i * kFields];
+                r[0] = -9.8f * sinf(pitch) + 0.1f * noise[0];
+                r[1] = 9.8f * cosf(pitch) * sinf(roll) + 0.1f * noise[1];
+                r[2] = 9.8f * cosf(pitch) * cosf(roll) + 0.1f * noise[2];
+                r[3] = 0.78f * cosf(1.3f * t) + 0.01f + 0.02f * noise[1];
+                r[4] = 0.28f * cosf(0.7f * t + 1.0f) - 0.02f + 0.02f * noise[2];
+                r[5] = 0.05f + 0.02f * noise[0];
+                r[6] = 0.001f;
+            }
+            if (csv) {
+                WriteCsv(fp, rec.data(), n, text);
+            } else {
+                fwrite(rec.data(), sizeof(float), (size_t) n * kFields, fp);
+            }
+        }
+        fclose(fp);
+        return true;
+    }
+
+    void PrintUsage() {
+        fprintf(stderr, "usage: kalman_replay [-q v] [-b v] [-r v] [-l v] [-m dense|sparse|sequential] [-s n] "
+                        "log.bin|log.csv out.bin|out.csv\n");
+    }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    float q1 = 10.0f, q2 = 0.001f, r = 10000000.0f, lambda = 0.9996f;
+    const char *mode = "sparse";
+    uint32_t synthetic = 0;
+    int argi = 1;
+    for (; argi + 1 < argc && argv[argi][0] == '-' && argv[argi][1] != '\0'; argi += 2) {
+        const char *val = argv[argi + 1];
+        switch (argv[argi][1]) {
+            case 'q': q1 = strtof(val, nullptr); break;
+            case 'b': q2 = strtof(val, nullptr); break;
+            case 'r': r = strtof(val, nullptr); break;
+            case 'l': lambda = strtof(val, nullptr); break;
+            case 'm': mode = val; break;
+            case 's': synthetic = (uint32_t) strtoul(val, nullptr, 10); break;
+            default: PrintUsage(); return 1;
+        }
+    }
+    if (argc - argi != 2) {
+        PrintUsage();
+        return 1;
+    }
+    const char *in_path = argv[argi];
+    const char *out_path = argv[argi + 1];
+    if (synthetic != 0 && !WriteSynthetic(in_path, synthetic)) {
+        fprintf(stderr, "cannot write %s\n", in_path);
+        return 1;
+    }
+
+    auto t_start = Clock::now();
+    MappedFile log(in_path);
+    if (log.data == nullptr) {
+        fprintf(stderr, "cannot map %s\n", in_path);
+        return 1;
+    }
+    FILE *fp = fopen(out_path, "wb");
+    if (fp == nullptr) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 1;
+    }
+    bool csv_in = EndsWith(in_path, ".csv");
+    bool csv_out = EndsWith(out_path, ".csv");
+
+    static EKF::cEKF ekf(q1, q2, r, lambda);
+    ekf.SetSparseUpdate(strcmp(mode, "dense") != 0);
+    ekf.SetSequentialUpdate(strcmp(mode, "sequential") == 0);
+
+    std::vector<float> imu((size_t) kBatch * kFields);
+    std::vector<float> out((size_t) kBatch * kFields);
+    std::vector<char> text;
+    const char *pos = log.data;
+    const char *end = log.data + log.size;
+    if (!csv_in && log.size % (kFields * sizeof(float)) != 0) {
+        fprintf(stderr, "%s: size is not a multiple of %u bytes, the tail is ignored\n", in_path,
+                (unsigned) (kFields * sizeof(float)));
+    }
+    uint64_t samples = 0;
+    uint64_t failed = 0;
+    double filter_time = 0.0;
+    while (true) {
+        const float *batch;
+        uint32_t n;
+        if (csv_in) {
+            n = ParseCsv(pos, end, imu.data(), kBatch);
+            batch = imu.data();
+        } else {
+            // The mapping is page aligned and records are whole floats, so the log is used in place
+            size_t left = (size_t) (end - pos) / (kFields * sizeof(float));
+            n = left < kBatch ? (uint32_t) left : kBatch;
+            batch = reinterpret_cast<const float *>(pos);
+            pos += (size_t) n * kFields * sizeof(float);
+        }
+        if (n == 0) { break; }
+        auto t0 = Clock::now();
+        failed += ekf.UpdateBatch(batch, n, out.data());
+        filter_time += Seconds(t0, Clock::now());
+        if (csv_out) {
+            WriteCsv(fp, out.data(), n, text);
+        } else {
+            fwrite(out.data(), sizeof(float), (size_t) n * kFields, fp);
+        }
+        samples += n;
+    }
+    fclose(fp);
+    double total_time = Seconds(t_start, Clock::now());
+
+    float q[4];
+    ekf.GetQuaternion(q);
+    printf("%llu samples, %llu failed, mode %s\n", (unsigned long long) samples, (unsigned long long) failed, mode);
+    printf("filter %.3f s, %.2f Msamples/s\n", filter_time, (double) samples / filter_time * 1e-6);
+    printf("total  %.3f s, %.2f Msamples/s\n", total_time, (double) samples / total_time * 1e-6);
+    printf("last q %f %f %f %f\n", q[0], q[1], q[2], q[3]);
+    return 0;
+}
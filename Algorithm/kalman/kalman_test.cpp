@@ -0,0 +1,693 @@
+#include "libkalman-1.0.hpp"
+#include "libkalman-ukf-1.0.hpp"
+#include "libkalman-i-imuekf-1.0.hpp"
+#include "libkalman-i-imuekf-lockstep-1.0.hpp"
+#include "libkalman-i-imuesekf-1.0.hpp"
+#include "libkalman-i-imupreint-1.0.hpp"
+#include "libkalman-i-imuasync-1.0.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+
+static uint32_t failed = 0;
+
+static void check(const char *name, float err, float tol = 1e-5f) {
+    bool ok = err <= tol;
+    if (!ok) { failed++; }
+    printf("%-40s %s (err %.3g)\n", name, ok ? "OK  " : "FAIL", err);
+}
+
+template<typename A, typename B>
+static float maxDiff(const A &a, const B &b) {
+    return (float) (a - b).cwiseAbs().maxCoeff();
+}
+
+template<typename Scalar, uint32_t N>
+static float maxDiff(const matrixf::SymMatrix<Scalar, N> &a, const matrixf::SymMatrix<Scalar, N> &b) {
+    float err = 0;
+    for (uint32_t i = 0; i < N; i++) {
+        for (uint32_t j = i; j < N; j++) { err = std::fmax(err, std::fabs(a(i, j) - b(i, j))); }
+    }
+    return err;
+}
+
+// Pendulum with a rate sensor bias, x = [angle, rate, bias]
+struct Pendulum {
+    template<typename T>
+    static Eigen::Vector<T, 3> f(const Eigen::Vector<T, 3> &x, const Eigen::Vector<T, 1> &u, float dt) {
+        using std::sin;
+        Eigen::Vector<T, 3> r;
+        r(0) = x(0) + x(1) * dt;
+        r(1) = x(1) + (u(0) - sin(x(0)) * 9.8f) * dt;
+        r(2) = x(2);
+        return r;
+    }
+    static Eigen::Matrix<float, 3, 3> F(const Eigen::Vector<float, 3> &x, const Eigen::Vector<float, 1> &, float dt) {
+        Eigen::Matrix<float, 3, 3> J;
+        J << 1, dt, 0,
+             -std::cos(x(0)) * 9.8f * dt, 1, 0,
+             0, 0, 1;
+        return J;
+    }
+    // Tip position and biased rate
+    template<typename T>
+    static Eigen::Vector<T, 3> h(const Eigen::Vector<T, 3> &x) {
+        using std::sin;
+        using std::cos;
+        Eigen::Vector<T, 3> z;
+        z(0) = sin(x(0)) * 0.5f;
+        z(1) = -cos(x(0)) * 0.5f;
+        z(2) = x(1) + x(2);
+        return z;
+    }
+    static Eigen::Matrix<float, 3, 3> H(const Eigen::Vector<float, 3> &x) {
+        Eigen::Matrix<float, 3, 3> J;
+        J << std::cos(x(0)) * 0.5f, 0, 0,
+             std::sin(x(0)) * 0.5f, 0, 0,
+             0, 1, 1;
+        return J;
+    }
+};
+
+// Exposes F and H of the last step
+class cKalmanTest : public KalmanA::cKalmanA<float, 3, 1, 3> {
+public:
+    const Eigen::Matrix<float, 3, 3> &F() const { return _matFk; }
+
+    const Eigen::Matrix<float, 3, 3> &H() const { return _matHk; }
+};
+
+static void testGenericEkf() {
+    cKalmanTest dual, hand;
+    Eigen::Vector<float, 3> x0(0.3f, 0.0f, 0.05f);
+    Eigen::Matrix<float, 3, 3> P0 = Eigen::Matrix<float, 3, 3>::Identity() * 0.1f;
+    Eigen::Matrix<float, 3, 3> Q = Eigen::Matrix<float, 3, 3>::Identity() * 1e-4f;
+    Eigen::Matrix<float, 3, 3> R = Eigen::Matrix<float, 3, 3>::Identity() * 1e-3f;
+    for (cKalmanTest *k : {&dual, &hand}) {
+        k->SetState(x0);
+        k->SetCovariance(P0);
+        k->SetProcessNoise(Q);
+        k->SetMeasureNoise(R);
+    }
+    Eigen::Vector<float, 3> xt(0.5f, 0.0f, 0.05f);
+    Eigen::Vector<float, 1> u(0.0f);
+    const float dt = 0.01f;
+    float err_f = 0, err_h = 0, err_x = 0, err_p = 0;
+    for (uint32_t k = 0; k < 200; k++) {
+        xt = Pendulum::f(xt, u, dt);
+        Eigen::Vector<float, 3> z = Pendulum::h(xt);
+        dual.Predict([](const auto &x, const auto &u, float dt) { return Pendulum::f(x, u, dt); }, u, dt);
+        hand.Predict([](const auto &x, const auto &u, float dt) { return Pendulum::f(x, u, dt); },
+                     Pendulum::F, u, dt);
+        err_f = std::fmax(err_f, maxDiff(dual.F(), hand.F()));
+        uint8_t s = dual.Update([](const auto &x) { return Pendulum::h(x); }, z);
+        s |= hand.Update([](const auto &x) { return Pendulum::h(x); }, Pendulum::H, z);
+        err_h = std::fmax(err_h + s, maxDiff(dual.H(), hand.H()));
+        err_x = std::fmax(err_x, maxDiff(dual.GetState(), hand.GetState()));
+        err_p = std::fmax(err_p, maxDiff(dual.GetCovariance(), hand.GetCovariance()));
+    }
+    check("generic EKF dual F vs hand F", err_f, 1e-6f);
+    check("generic EKF dual H vs hand H", err_h, 1e-6f);
+    check("generic EKF dual x vs hand x", err_x);
+    check("generic EKF dual P vs hand P", err_p, 1e-6f);
+    check("generic EKF tracks the angle", std::fabs(dual.GetState()(0) - xt(0)), 1e-2f);
+}
+
+// Constant velocity in the plane, x = [px, py, vx, vy]
+struct Plane {
+    template<typename T, typename U>
+    static Eigen::Vector<T, 4> f(const Eigen::Vector<T, 4> &x, const U &, float dt) {
+        Eigen::Vector<T, 4> r = x;
+        r(0) += x(2) * dt;
+        r(1) += x(3) * dt;
+        return r;
+    }
+    // Linear, the UKF and the EKF are the same filter
+    template<typename T>
+    static Eigen::Vector<T, 2> h(const Eigen::Vector<T, 4> &x) {
+        Eigen::Vector<T, 2> z;
+        z(0) = x(0) + x(1) * 0.5f;
+        z(1) = x(1);
+        return z;
+    }
+    // Range and bearing from the origin
+    static Eigen::Vector<float, 2> polar(const Eigen::Vector<float, 4> &x) {
+        return Eigen::Vector<float, 2>(std::sqrt(x(0) * x(0) + x(1) * x(1)), std::atan2(x(1), x(0)));
+    }
+};
+
+// Exposes the pivots of the last sigma points
+class cUKFTest : public KalmanA::cUKF<float, 4, 1, 2> {
+public:
+    float Pivot(uint32_t i) const { return _l[i][i]; }
+};
+
+/**
+ * vy is known exactly, P and Q are 0 along it, so the sigma points take the
+ * floor path of Cholesky() on every step.
+ */
+static void testUkf() {
+    cUKFTest ukf, soa;
+    KalmanA::cKalmanA<float, 4, 1, 2> ekf;
+    Eigen::Vector<float, 4> x0(1.0f, 2.0f, 0.5f, 0.0f);
+    Eigen::Matrix<float, 4, 4> P0 = Eigen::Vector<float, 4>(1.0f, 1.0f, 0.1f, 0.0f).asDiagonal();
+    Eigen::Matrix<float, 4, 4> Q = Eigen::Vector<float, 4>(1e-4f, 1e-4f, 1e-4f, 0.0f).asDiagonal();
+    Eigen::Matrix<float, 2, 2> R = Eigen::Matrix<float, 2, 2>::Identity() * 1e-2f;
+    ukf.SetState(x0);
+    ukf.SetCovariance(P0);
+    ukf.SetProcessNoise(Q);
+    ukf.SetMeasureNoise(R);
+    soa = ukf;
+    ekf.SetState(x0);
+    ekf.SetCovariance(P0);
+    ekf.SetProcessNoise(Q);
+    ekf.SetMeasureNoise(R);
+    Eigen::Vector<float, 4> xt(1.2f, 1.9f, 0.4f, 0.0f);
+    Eigen::Vector<float, 1> u(0.0f);
+    const float dt = 0.1f;
+    uint8_t s = 0;
+    float err_x = 0, err_p = 0, floor = 0;
+    for (uint32_t k = 0; k < 50; k++) {
+        xt = Plane::f(xt, u, dt);
+        Eigen::Vector<float, 2> z = Plane::h(xt) + Eigen::Vector<float, 2>(0.05f, -0.03f) * std::sin((float) k);
+        s |= ukf.Predict([](const auto &x, const auto &u, float dt) { return Plane::f(x, u, dt); }, u, dt);
+        floor += ukf.Pivot(3);
+        ekf.Predict([](const auto &x, const auto &u, float dt) { return Plane::f(x, u, dt); }, u, dt);
+        s |= ukf.Update([](const auto &x) { return Plane::h(x); }, z);
+        floor += ukf.Pivot(3);
+        s |= ekf.Update([](const auto &x) { return Plane::h(x); }, z);
+        err_x = std::fmax(err_x, maxDiff(ukf.GetState(), ekf.GetState()));
+        err_p = std::fmax(err_p, maxDiff(ukf.GetCovariance(), ekf.GetCovariance()));
+    }
+    check("UKF linear vs EKF x", err_x + s, 1e-5f);
+    check("UKF linear vs EKF P", err_p, 1e-6f);
+    check("UKF floor path, vy has no spread", floor + ukf.GetCovariance()(3, 3), 0.0f);
+
+    // Nonlinear h, the same filter per sigma point and on the SoA rows
+    soa = ukf;
+    err_x = err_p = 0;
+    for (uint32_t k = 0; k < 50; k++) {
+        xt = Plane::f(xt, u, dt);
+        Eigen::Vector<float, 2> z = Plane::polar(xt);
+        s |= ukf.Predict([](const auto &x, const auto &u, float dt) { return Plane::f(x, u, dt); }, u, dt);
+        s |= soa.PredictSoA([](auto &X, const auto &, float dt) {
+            X.row(0) += X.row(2) * dt;
+            X.row(1) += X.row(3) * dt;
+        }, u, dt);
+        s |= ukf.Update([](const auto &x) { return Plane::polar(x); }, z);
+        s |= soa.UpdateSoA([](const auto &X, auto &Z) {
+            Z.row(0) = (X.row(0).array().square() + X.row(1).array().square()).sqrt();
+            for (uint32_t i = 0; i < cUKFTest::kSigma; i++) { Z(1, i) = std::atan2(X(1, i), X(0, i)); }
+        }, z);
+        err_x = std::fmax(err_x, maxDiff(ukf.GetState(), soa.GetState()));
+        err_p = std::fmax(err_p, maxDiff(ukf.GetCovariance(), soa.GetCovariance()));
+    }
+    check("UKF Update vs UpdateSoA x", err_x + s, 1e-6f);
+    check("UKF Update vs UpdateSoA P", err_p, 1e-7f);
+    check("UKF tracks the position", (ukf.GetState().head<2>() - xt.head<2>()).norm(), 2e-2f);
+
+    // Refused by the gate: neither x nor P change
+    cUKFTest gated = ukf;
+    gated.SetChi2Gate(1e-6f);
+    s = gated.Update([](const auto &x) { return Plane::polar(x); }, Plane::polar(xt) * 1.1f);
+    check("UKF gated keeps x and P", (float) (s != 0x01) + maxDiff(gated.GetState(), ukf.GetState()) +
+                                     maxDiff(gated.GetCovariance(), ukf.GetCovariance()), 0.0f);
+}
+
+// Gravity seen by a body rocking about x and y, gyro at k·dt with a small bias, like kalman_bench.cpp
+static void imuSample(uint32_t k, float dt, float *accel, float *gyro) {
+    float t = (float) k * dt;
+    float roll = 0.3f * std::sin(0.7f * t), pitch = 0.2f * std::sin(0.4f * t + 1.0f);
+    accel[0] = -9.8f * std::sin(pitch);
+    accel[1] = 9.8f * std::cos(pitch) * std::sin(roll);
+    accel[2] = 9.8f * std::cos(pitch) * std::cos(roll);
+    gyro[0] = 0.21f * std::cos(0.7f * t) + 0.01f;
+    gyro[1] = 0.08f * std::cos(0.4f * t + 1.0f) - 0.02f;
+    gyro[2] = 0.003f;
+}
+
+// Runs the correction steps of cEKF alone on a prepared measurement
+class cEKFTest : public EKF::cEKF {
+public:
+    // Accelerometer variance small enough for corrections well above rounding
+    cEKFTest() : EKF::cEKF(10, 0.001f, 0.1f, 0.9996f) {}
+
+    /**
+     * z as the next measurement at the current x, chi square state as given.
+     * The bias rows of K are shaped by acos(|h|)·2/pi, pi/2 makes that 1 so
+     * the dense and the sequential update are the same algebra.
+     */
+    void Prepare(const Eigen::Vector<float, 3> &z, float threshold, uint8_t chi_stable) {
+        _vecZk = z;
+        Eigen::Vector<float, 3> zhat;
+        KalmanA::Jacobian<3, 6>([](const auto &x) { return MeasureModel(x); }, _vecXhat, zhat, _matHk);
+        _vec_chi = z - zhat;
+        _orientation_cosine[0] = 1.57079632679f;
+        _orientation_cosine[1] = 1.57079632679f;
+        _chi2threshold = threshold;
+        _chi_square_stable = chi_stable;
+        _chi_square_stable_once = 0;
+        _chi_square_err_cnt = 0;
+        _stable = 0;
+    }
+
+    // Drop measurement axis i, h and z of it become 0
+    void DropAxis(uint32_t i) {
+        _matHk.row(i).setZero();
+        _vec_chi(i) = 0;
+        _vecZk(i) = 0;
+    }
+
+    // Divergence counter at its limit, the next unstable chi square is the 51st
+    void AtDivergence() {
+        _stable = 1;
+        _chi_square_err_cnt = 50;
+    }
+
+    uint8_t Dense() { return CorrectDense<false>(1.0f); }
+
+    uint8_t Sequential() { return CorrectSequential(1.0f); }
+
+    Eigen::Vector<float, 3> Predicted() const { return MeasureModel(_vecXhat); }
+
+    float Chi2() const { return _chiSquare(0); }
+
+    const Eigen::Matrix<float, 6, 3> &K() const { return _matK; }
+
+    static uint32_t Crc(const uint8_t *data, uint32_t len) { return Crc32(data, len); }
+};
+
+static void testSequentialEkf() {
+    cEKFTest base;
+    float accel[3], gyro[3];
+    const float dt = 0.001f;
+    for (uint32_t k = 0; k < 2000; k++) {
+        imuSample(k, dt, accel, gyro);
+        base.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+    }
+    Eigen::Vector<float, 3> z = base.Predicted() + Eigen::Vector<float, 3>(0.02f, -0.015f, 0.01f);
+
+    // Gate off (chi square never stable): sequential scalar updates are the dense update
+    cEKFTest dense = base, seq = base;
+    dense.Prepare(z, 1e-8f, 0);
+    seq.Prepare(z, 1e-8f, 0);
+    uint8_t s = dense.Dense() | seq.Sequential();
+    check("cEKF sequential vs dense x", maxDiff(seq.GetState(), dense.GetState()) + s, 1e-6f);
+    check("cEKF sequential corrects x", maxDiff(seq.GetState(), base.GetState()) > 1e-3f ? 0.0f : 1.0f, 0.0f);
+    check("cEKF sequential vs dense P", maxDiff(seq.GetCovariance(), dense.GetCovariance()) /
+                                        (float) dense.GetCovariance()(0, 0), 1e-4f);
+
+    // One outlier axis: skipped, the others update as if it was not measured
+    float threshold = 4.0f * seq.Chi2();
+    Eigen::Vector<float, 3> z_out = z;
+    z_out(1) += 0.5f;
+    cEKFTest gated = base, ref = base;
+    gated.Prepare(z_out, threshold, 1);
+    ref.Prepare(z_out, threshold, 1);
+    ref.DropAxis(1);
+    s = gated.Sequential() | ref.Sequential();
+    check("cEKF outlier axis has no gain", gated.K().col(1).cwiseAbs().maxCoeff() + s, 0.0f);
+    check("cEKF other axes have gain", gated.K().col(0).cwiseAbs().maxCoeff() > 0 &&
+                                       gated.K().col(2).cwiseAbs().maxCoeff() > 0 ? 0.0f : 1.0f, 0.0f);
+    check("cEKF outlier skipped, x", maxDiff(gated.GetState(), ref.GetState()), 0.0f);
+    check("cEKF outlier skipped, P", maxDiff(gated.GetCovariance(), ref.GetCovariance()), 0.0f);
+
+    // Divergence with every axis inside its own gate: neither x nor P change
+    cEKFTest probe = base, div = base;
+    Eigen::Vector<float, 3> z_div = base.Predicted() + Eigen::Vector<float, 3>(0.1f, -0.1f, 0.1f);
+    probe.Prepare(z_div, 1e-8f, 0);
+    probe.Sequential();
+    threshold = 1.2f * probe.Chi2();
+    div.Prepare(z_div, threshold, 1);
+    div.AtDivergence();
+    s = div.Sequential();
+    check("cEKF divergence returns 0x01", s == 0x01 ? 0.0f : 1.0f, 0.0f);
+    check("cEKF divergence used every axis", div.K().colwise().norm().minCoeff() > 0 ? 0.0f : 1.0f, 0.0f);
+    check("cEKF divergence keeps x", maxDiff(div.GetState(), base.GetState()), 0.0f);
+    check("cEKF divergence keeps P", maxDiff(div.GetCovariance(), base.GetCovariance()), 0.0f);
+}
+
+// Writes P of one lane
+template<uint32_t _count>
+class cEKFLockstepTest : public EKF::cEKFLockstep<_count> {
+public:
+    using EKF::cEKFLockstep<_count>::cEKFLockstep;
+
+    void SetCovariance(uint32_t lane, const Eigen::Matrix<float, 6, 6> &P) {
+        for (uint32_t i = 0; i < 6; i++) {
+            for (uint32_t j = i; j < 6; j++) { this->_pk[this->P(i, j)][lane] = P(i, j); }
+        }
+    }
+};
+
+/**
+ * The same run dense, with the sparse kernels, sequential, and sequential on
+ * the sparse kernels, all from one converged state: the diffuse initial P
+ * makes the first steps sensitive to rounding, FMA contraction alone gives
+ * other numbers there. Yaw is not observed, so sequential and dense are
+ * compared on the gravity direction.
+ */
+static void testSparseEkf() {
+    cEKFTest dense;
+    float accel[3], gyro[3];
+    const float dt = 0.001f;
+    for (uint32_t k = 0; k < 2000; k++) {
+        imuSample(k, dt, accel, gyro);
+        dense.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+    }
+    cEKFTest sparse = dense, seq = dense, seq_sparse = dense;
+    sparse.SetSparseUpdate(1);
+    seq.SetSequentialUpdate(1);
+    seq_sparse.SetSequentialUpdate(1);
+    seq_sparse.SetSparseUpdate(1);
+    float err_x = 0, err_p = 0, err_sx = 0, err_sp = 0, err_g = 0, err_gp = 0;
+    uint8_t s = 0;
+    for (uint32_t k = 2000; k < 5000; k++) {
+        imuSample(k, dt, accel, gyro);
+        for (cEKFTest *f : {&dense, &sparse, &seq, &seq_sparse}) {
+            s |= f->UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+        }
+        float p_scale = 0;
+        for (uint32_t i = 0; i < 6; i++) { p_scale = std::fmax(p_scale, (float) dense.GetCovariance()(i, i)); }
+        err_x = std::fmax(err_x, maxDiff(sparse.GetState(), dense.GetState()));
+        err_p = std::fmax(err_p, maxDiff(sparse.GetCovariance(), dense.GetCovariance()) / p_scale);
+        err_sx = std::fmax(err_sx, maxDiff(seq_sparse.GetState(), seq.GetState()));
+        err_sp = std::fmax(err_sp, maxDiff(seq_sparse.GetCovariance(), seq.GetCovariance()) / p_scale);
+        err_g = std::fmax(err_g, maxDiff(seq_sparse.Predicted(), dense.Predicted()));
+        err_gp = std::fmax(err_gp, maxDiff(seq_sparse.GetCovariance(), dense.GetCovariance()) / p_scale);
+    }
+    check("cEKF sparse vs dense x", err_x + s, 1e-5f);
+    check("cEKF sparse vs dense P", err_p, 1e-5f);
+    check("cEKF sequential sparse vs sequential x", err_sx, 1e-5f);
+    check("cEKF sequential sparse vs sequential P", err_sp, 1e-5f);
+    check("cEKF sequential sparse vs dense tilt", err_g, 1e-5f);
+    check("cEKF sequential sparse vs dense P", err_gp, 1e-3f);
+}
+
+/**
+ * Lanes against one cEKF each on the same data. 11 instances, so the second
+ * step of 8 lanes has padding; lane 3 turns too fast for the stable mask,
+ * lane 5 gets an accelerometer that jumps every other step until it diverges
+ * and lane 7 gets a P that makes A not positive definite.
+ */
+static void testLockstepEkf() {
+    constexpr uint32_t kCount = 11;
+    static cEKFLockstepTest<kCount> fleet(10, 0.001f, 10000000, 0.9996f);
+    static EKF::cEKF *single[kCount];
+    for (uint32_t l = 0; l < kCount; l++) { single[l] = new EKF::cEKF(10, 0.001f, 10000000, 0.9996f); }
+    float accel[3 * kCount], gyro[3 * kCount];
+    const float dt = 0.001f;
+    float err_q = 0, err_b = 0;
+    uint32_t status_mismatch = 0, diverged_5 = 0, diverged_other = 0, failed_7 = 0;
+    uint8_t finite = 1;
+    Eigen::Matrix<float, 6, 6> P_bad = Eigen::Vector<float, 6>(-1e8f, -1e8f, -1e8f, -1e8f, 100, 100).asDiagonal();
+    for (uint32_t k = 0; k < 3000; k++) {
+        if (k == 1500) {
+            fleet.SetCovariance(7, P_bad);
+            single[7]->SetCovariance(P_bad);
+        }
+        for (uint32_t l = 0; l < kCount; l++) {
+            float a[3], g[3];
+            imuSample(k + 700 * l, dt, a, g);
+            if (l == 3) { g[2] += 0.5f; }
+            if (l == 5 && k >= 1000 && (k & 1)) {
+                a[0] = 6.0f;
+                a[1] = 0.0f;
+                a[2] = 7.7f;
+            }
+            for (uint32_t i = 0; i < 3; i++) {
+                accel[i * kCount + l] = a[i];
+                gyro[i * kCount + l] = g[i];
+            }
+        }
+        fleet.UpdateQuaternion(accel, gyro, dt);
+        for (uint32_t l = 0; l < kCount; l++) {
+            uint8_t st = single[l]->UpdateQuaternion(accel[l], accel[kCount + l], accel[2 * kCount + l],
+                                                     gyro[l], gyro[kCount + l], gyro[2 * kCount + l], dt);
+            status_mismatch += st != fleet.GetStatus(l);
+            (l == 5 ? diverged_5 : (l == 7 ? failed_7 : diverged_other)) += st;
+            float q[4], ql[4], b[3], bl[3];
+            single[l]->GetQuaternion(q);
+            fleet.GetQuaternion(l, ql);
+            for (uint32_t i = 0; i < 4; i++) {
+                err_q = std::fmax(err_q, std::fabs(q[i] - ql[i]));
+                finite &= std::isfinite(ql[i]);
+            }
+            fleet.GetGyroBias(l, bl);
+            b[0] = single[l]->GetState()(4);
+            b[1] = single[l]->GetState()(5);
+            err_b = std::fmax(err_b, std::fmax(std::fabs(b[0] - bl[0]), std::fabs(b[1] - bl[1])));
+        }
+    }
+    for (uint32_t l = 0; l < kCount; l++) { delete single[l]; }
+    check("lockstep quaternion vs cEKF", err_q, 1e-4f);
+    check("lockstep bias vs cEKF", err_b, 1e-5f);
+    check("lockstep status vs cEKF", (float) status_mismatch, 0.0f);
+    check("lockstep lane 5 diverges", diverged_5 > 0 ? 0.0f : 1.0f, 0.0f);
+    check("lockstep other lanes do not", (float) diverged_other, 0.0f);
+    check("lockstep lane 7 skips, stays finite", failed_7 == 1500 && finite ? 0.0f : 1.0f, 0.0f);
+}
+
+// Tilt between the gravity directions of two attitudes, rad
+static float tiltError(const Eigen::Quaternion<float> &a, const Eigen::Quaternion<float> &b) {
+    Eigen::Vector<float, 3> ga = a.toRotationMatrix().row(2), gb = b.toRotationMatrix().row(2);
+    return std::acos(std::fmin(1.0f, ga.dot(gb)));
+}
+
+// Exact rotation of the rotation vector h, double for reference attitudes
+static Eigen::Quaterniond rotation(const Eigen::Vector3d &h) {
+    double n = h.norm();
+    if (n < 1e-300) { return Eigen::Quaterniond::Identity(); }
+    Eigen::Vector3d v = h * (std::sin(n * 0.5) / n);
+    return Eigen::Quaterniond(std::cos(n * 0.5), v(0), v(1), v(2));
+}
+
+// Constant bias on all three axes, the body tilts so the z bias is observable
+static void testEsekfBias() {
+    EKF::cESEKF es(1e-4f, 1e-8f, 1e-3f);
+    const Eigen::Vector3d bias(0.01, -0.02, 0.03);
+    Eigen::Quaterniond qt(Eigen::AngleAxisd(0.3, Eigen::Vector3d(1, 0.5, 0).normalized()));
+    const double dt = 0.002;
+    for (uint32_t k = 0; k < 150000; k++) {
+        double t = k * dt;
+        Eigen::Vector3d w(0.78 * std::cos(1.3 * t), 0.28 * std::cos(0.7 * t + 1.0), 0.2 * std::sin(0.3 * t));
+        qt = (qt * rotation(w * dt)).normalized();
+        Eigen::Vector3d a = qt.toRotationMatrix().transpose() * Eigen::Vector3d(0, 0, 9.8);
+        Eigen::Vector3d g = w + bias;
+        es.UpdateQuaternion((float) a(0), (float) a(1), (float) a(2), (float) g(0), (float) g(1), (float) g(2),
+                            (float) dt);
+    }
+    float b[3];
+    es.GetGyroBias(b);
+    float err_b = 0;
+    for (uint32_t i = 0; i < 3; i++) { err_b = std::fmax(err_b, std::fabs(b[i] - (float) bias(i))); }
+    check("ESEKF gyro bias converges", err_b, 1e-3f);
+    check("ESEKF tilt", tiltError(es.Quaternion(), qt.cast<float>()), 1e-3f);
+}
+
+// One batch predict against the same samples one by one
+static void testEsekfPreint() {
+    EKF::cESEKF step(1e-4f, 1e-8f, 1e-3f);
+    float accel[3], gyro[3];
+    const float dt = 0.001f;
+    for (uint32_t k = 0; k < 2000; k++) {
+        imuSample(k, dt, accel, gyro);
+        step.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+    }
+    EKF::cESEKF batch = step;
+    float bias[3], fifo[3 * 20];
+    batch.GetGyroBias(bias);
+    EKF::cGyroPreint preint;
+    for (uint32_t k = 0; k < 20; k++) {
+        imuSample(2000 + k, dt, accel, &fifo[3 * k]);
+        step.PredictGyro(fifo[3 * k], fifo[3 * k + 1], fifo[3 * k + 2], dt);
+    }
+    preint.Integrate(fifo, 20, dt, bias);
+    batch.PredictPreint(preint);
+    check("ESEKF preint vs per sample, q", maxDiff(batch.Quaternion().coeffs(), step.Quaternion().coeffs()), 1e-6f);
+    check("ESEKF preint vs per sample, P", maxDiff(batch.GetCovariance(), step.GetCovariance()) /
+                                           (float) step.GetCovariance()(0, 0), 1e-4f);
+}
+
+/**
+ * Rate vector turning at 50 Hz about z, sampled as the mean rate of each
+ * 1 ms interval like an integrating gyro. The attitude error of a plain
+ * product of the sample rotations grows with the coning motion.
+ */
+static void testConing() {
+    const double dt = 0.001, omega = 2 * M_PI * 50, amp = 10;
+    const float zero[3] = {0, 0, 0};
+    EKF::cGyroPreint preint;
+    Eigen::Quaternion<float> plain(1, 0, 0, 0);
+    Eigen::Quaterniond truth(1, 0, 0, 0);
+    for (uint32_t k = 0; k < 64; k++) {
+        for (uint32_t s = 0; s < 64; s++) {
+            double t = (k * 64 + s + 0.5) * dt / 64;
+            Eigen::Vector3d w(amp * std::cos(omega * t), amp * std::sin(omega * t), 0.5);
+            truth = (truth * rotation(w * (dt / 64))).normalized();
+        }
+        double t0 = k * dt, t1 = t0 + dt;
+        float g[3] = {(float) (amp * (std::sin(omega * t1) - std::sin(omega * t0)) / (omega * dt)),
+                      (float) (-amp * (std::cos(omega * t1) - std::cos(omega * t0)) / (omega * dt)), 0.5f};
+        preint.Add(g[0], g[1], g[2], (float) dt, zero);
+        Eigen::Vector3d h(g[0] * dt, g[1] * dt, g[2] * dt);
+        plain = (plain * rotation(h).cast<float>()).normalized();
+    }
+    auto error = [&](const Eigen::Quaternion<float> &q) {
+        return (float) (2 * (q.cast<double>().conjugate() * truth).vec().norm());
+    };
+    float err_coning = error(preint.Rotation()), err_plain = error(plain);
+    check("preint coning beats plain summation", err_coning / err_plain, 0.1f);
+}
+
+// Records what cImuAsync feeds it, gx carries the time of the sample in ms
+struct AsyncLog {
+    float t[64], dt[64];
+    uint8_t accel[64];
+    uint32_t n = 0;
+    Eigen::Quaternion<float> q = Eigen::Quaternion<float>::Identity();
+
+    void PredictGyro(float gx, float, float, float dt_) {
+        t[n] = gx;
+        dt[n] = dt_;
+        accel[n++] = 0;
+    }
+
+    uint8_t CorrectAccel(float ax, float, float) {
+        t[n] = ax;
+        dt[n] = 0;
+        accel[n++] = 1;
+        return 0;
+    }
+
+    const Eigen::Quaternion<float> &Quaternion() const { return q; }
+
+    void GetGyroBias(float *bias) const { bias[0] = bias[1] = bias[2] = 0; }
+};
+
+static void testAsync() {
+    // Out of order inside the delay window, across the uint32 wrap of the timestamps
+    const uint32_t t0 = 0xFFFFE000u;
+    const uint32_t order[] = {0, 2, 1, 3, 5, 4, 6, 7, 9, 8, 10, 11};
+    AsyncLog log;
+    EKF::cImuAsync<AsyncLog> front(log, 2500);
+    uint8_t s = 0;
+    for (uint32_t i : order) { s |= front.PushGyro(t0 + i * 1000u, (float) i, 0, 0); }
+    s |= front.PushAccel(t0 + 10500u, 10.5f, 0, 0);
+    uint32_t released = log.n;
+    front.Flush();
+    // The first gyro sample only sets the time, the accelerometer predicts with the rate of sample 10
+    const float want_t[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10.5f, 11};
+    float err_order = (float) s + (float) (log.n != 13) + (float) (released == 0 || released >= log.n);
+    float err_dt = 0;
+    for (uint32_t i = 0; i < log.n && i < 13; i++) {
+        err_order += log.t[i] != want_t[i] || log.accel[i] != (i == 11);
+        float want_dt = i == 11 ? 0.0f : (i >= 10 ? 5e-4f : 1e-3f);
+        err_dt = std::fmax(err_dt, std::fabs(log.dt[i] - want_dt));
+    }
+    check("async out of order, time order", err_order, 0.0f);
+    check("async timestamp wrap, dt", err_dt, 1e-7f);
+    check("async flush", (float) (front.FilterTime() != t0 + 11000u), 0.0f);
+
+    // Older than the filter time: dropped and counted
+    uint32_t n = log.n;
+    s = front.PushGyro(t0 + 10000u, 10, 0, 0);
+    s |= front.PushAccel(t0 + 10999u, 10, 0, 0) << 1;
+    front.Flush();
+    check("async late samples dropped", (float) (s != 0x03 || front.LateCount() != 2 || log.n != n), 0.0f);
+
+    // Full buffer: a late sample is dropped without releasing another, a sample older
+    // than every buffered one but not late is the one released
+    AsyncLog full_log;
+    EKF::cImuAsync<AsyncLog, 4> full(full_log, 100000);
+    s = 0;
+    for (uint32_t i = 1; i <= 5; i++) { s |= full.PushGyro(i * 1000u, (float) i, 0, 0); }
+    uint32_t t_full = full.FilterTime();
+    uint8_t late = full.PushGyro(500u, 0.5f, 0, 0);
+    uint32_t t_late = full.FilterTime();
+    s |= full.PushGyro(1500u, 1.5f, 0, 0);
+    check("async full buffer, late drop", (float) (s != 0 || late != 0x01 || full.LateCount() != 1 ||
+                                                   t_full != 1000u || t_late != 1000u), 0.0f);
+    check("async full buffer, oldest released", (float) (full.FilterTime() != 1500u || full_log.n != 1 ||
+                                                         full_log.t[0] != 1.5f), 0.0f);
+
+    // Before the first release: only the time between the buffered samples counts
+    AsyncLog idle;
+    EKF::cImuAsync<AsyncLog> wait(idle, 100000);
+    wait.PushGyro(4000000000u, 0, 0, 1.0f);
+    wait.PushGyro(4000001000u, 0, 0, 1.0f);
+    float q[4];
+    wait.GetQuaternion(q);
+    check("async quaternion before first release", std::fabs(q[3] - std::sin(0.0005f)) + (float) idle.n, 1e-6f);
+}
+
+static void testSaveState() {
+    cEKFTest a, b, c;
+    float accel[3], gyro[3];
+    const float dt = 0.001f;
+    for (uint32_t k = 0; k < 3000; k++) {
+        imuSample(k, dt, accel, gyro);
+        a.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+    }
+    uint8_t blob[EKF::cEKF::StateSize()];
+    uint32_t n = a.SaveState(blob, sizeof(blob));
+    uint8_t s = b.LoadState(blob, n);
+    float err = 0;
+    for (uint32_t k = 3000; k < 4000; k++) {
+        imuSample(k, dt, accel, gyro);
+        s |= a.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+        s |= b.UpdateQuaternion(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2], dt);
+        err = std::fmax(err, maxDiff(a.GetState(), b.GetState()));
+        err = std::fmax(err, maxDiff(a.GetCovariance(), b.GetCovariance()));
+    }
+    check("SaveState round trip, same steps", err + (float) s + (float) (n != sizeof(blob)), 0.0f);
+
+    // Refused blobs leave the filter as it was
+    n = a.SaveState(blob, sizeof(blob));
+    Eigen::Vector<float, 6> x = c.GetState();
+    blob[40] ^= 0x04;
+    s = c.LoadState(blob, n);
+    blob[40] ^= 0x04;
+    check("LoadState refuses a flipped byte", (float) (s != 0x01) + maxDiff(c.GetState(), x), 0.0f);
+    uint16_t version = 2;
+    memcpy(blob + 4, &version, sizeof(version));
+    uint32_t crc = cEKFTest::Crc(blob, n - 4);
+    memcpy(blob + n - 4, &crc, sizeof(crc));
+    s = c.LoadState(blob, n);
+    check("LoadState refuses another version", (float) (s != 0x01) + maxDiff(c.GetState(), x), 0.0f);
+    s = c.LoadState(blob, n - 1);
+    check("LoadState refuses a short blob", (float) (s != 0x01) + maxDiff(c.GetState(), x), 0.0f);
+
+    // keep_attitude = 0: bias and its variance kept, the quaternion part restarts
+    n = a.SaveState(blob, sizeof(blob));
+    s = c.LoadState(blob, n, 0);
+    cEKFTest fresh;
+    float q[4];
+    c.GetQuaternion(q);
+    err = (float) s + std::fabs(q[0] - 1.0f) + std::fabs(q[1]) + std::fabs(q[2]) + std::fabs(q[3]);
+    err += maxDiff(c.GetState().tail<2>(), a.GetState().tail<2>());
+    for (uint32_t i = 0; i < 6; i++) {
+        for (uint32_t j = i; j < 6; j++) {
+            float want = i >= 4 ? a.GetCovariance()(i, j) : fresh.GetCovariance()(i, j);
+            err += std::fabs(c.GetCovariance()(i, j) - want);
+        }
+    }
+    check("LoadState without attitude", err, 0.0f);
+}
+
+int main() {
+    testGenericEkf();
+    testUkf();
+    testSequentialEkf();
+    testSparseEkf();
+    testLockstepEkf();
+    testSaveState();
+    testEsekfBias();
+    testEsekfPreint();
+    testConing();
+    testAsync();
+
+    printf("%s\n", failed ? "Some tests failed" : "All tests passed");
+    return failed ? 1 : 0;
+}
@@ -9,10 +9,52 @@
 #ifndef LIB_KALMAN_
 #define LIB_KALMAN_
 
+#include <type_traits>
+
 #include "../Eigen/Dense"
+#include "../matrix/matrix_sym.h"
+#include "../matrix/dual.h"
+
+namespace Eigen {
+    // Dual numbers as Eigen scalars, so models can be written on Eigen vectors of any scalar
+    template<typename T, uint32_t N>
+    struct NumTraits<matrixf::Dual<T, N>> : NumTraits<T> {
+        typedef matrixf::Dual<T, N> Real;
+        typedef matrixf::Dual<T, N> NonInteger;
+        typedef matrixf::Dual<T, N> Literal;
+        typedef matrixf::Dual<T, N> Nested;
+        enum {
+            IsComplex = 0,
+            IsInteger = 0,
+            IsSigned = 1,
+            RequireInitialization = 1,
+            ReadCost = (N + 1) * NumTraits<T>::ReadCost,
+            AddCost = (N + 1) * NumTraits<T>::AddCost,
+            MulCost = (2 * N + 1) * NumTraits<T>::MulCost
+        };
+    };
+}
 
 namespace KalmanA {
 
+    /**
+     * y = f(x) and J = df/dx in one pass by forward differentiation.
+     * f takes const Eigen::Vector<T, Xsize>& and returns Eigen::Vector<T, Ysize>
+     * for any scalar T, e.g. a generic lambda or a static template function.
+     */
+    template<uint32_t Ysize, uint32_t Xsize, typename Scalar, typename Func>
+    MATRIX_INLINE void Jacobian(Func &&f, const Eigen::Vector<Scalar, Xsize> &x,
+                  Eigen::Vector<Scalar, Ysize> &y, Eigen::Matrix<Scalar, Ysize, Xsize> &J) {
+        using D = matrixf::Dual<Scalar, Xsize>;
+        Eigen::Vector<D, Xsize> xd;
+        matrixf::small::unroll<Xsize>([&](auto j) MATRIX_LAMBDA_INLINE { xd.coeffRef(j) = D(x.coeff(j), j); });
+        Eigen::Vector<D, Ysize> yd = f(xd);
+        matrixf::small::unroll<Ysize>([&](auto i) MATRIX_LAMBDA_INLINE {
+            y.coeffRef(i) = yd.coeff(i).v;
+            matrixf::small::unroll<Xsize>([&](auto j) MATRIX_LAMBDA_INLINE { J.coeffRef(i, j) = yd.coeff(i).d[j]; });
+        });
+    }
+
     template<typename Scalar, uint32_t Xsize, uint32_t Usize, uint32_t Zsize>
     class cKalmanA {
     protected:
@@ -22,7 +64,7 @@ namespace KalmanA {
         Eigen::Vector<Scalar, Zsize> _vecZk;
 
         /*Middle matrix*/
-        Eigen::Matrix<Scalar, Xsize, Xsize> _matPk;
+        matrixf::SymMatrix<Scalar, Xsize> _matPk;  // Covariance, packed upper triangle
         Eigen::Matrix<Scalar, Xsize, Zsize> _matK;
 
         /*Const matrix*/
@@ -32,6 +74,9 @@ namespace KalmanA {
         Eigen::Matrix<Scalar, Zsize, Xsize> _matHk;
         Eigen::Matrix<Scalar, Zsize, Zsize> _matRk;
 
+        Scalar _chi2;       // Chi square of the last Update()
+        Scalar _chi2_gate;  // Update() rejects a chi square above it, 0 disables the test
+        Scalar _chi2_gate1; // UpdateSequential() skips a component whose chi square is above it, 0 disables
 
     public:
         cKalmanA() :
@@ -40,7 +85,7 @@ namespace KalmanA {
                 _vecZk(Eigen::Vector<Scalar, Zsize>::Zero()),
 
                 /*Middle matrix*/
-                _matPk(Eigen::Matrix<Scalar, Xsize, Xsize>::Zero()),
+                _matPk(),
                 _matK(Eigen::Matrix<Scalar, Xsize, Zsize>::Zero()),
 
                 /*Const matrix*/
@@ -48,7 +93,8 @@ namespace KalmanA {
                 _matBk(Eigen::Matrix<Scalar, Xsize, Usize>::Zero()),
                 _matQk(Eigen::Matrix<Scalar, Xsize, Xsize>::Zero()),
                 _matHk(Eigen::Matrix<Scalar, Zsize, Xsize>::Zero()),
-                _matRk(Eigen::Matrix<Scalar, Zsize, Zsize>::Zero()) {};
+                _matRk(Eigen::Matrix<Scalar, Zsize, Zsize>::Zero()),
+                _chi2(0), _chi2_gate(0), _chi2_gate1(0) {};
 
         cKalmanA(Eigen::Matrix<Scalar, Xsize, Xsize> &matFk,
                  Eigen::Matrix<Scalar, Xsize, Usize> &matBk,
@@ -57,9 +103,10 @@ namespace KalmanA {
                  Eigen::Matrix<Scalar, Zsize, Zsize> &matRk
         ) :
                 _vecXhat(Eigen::Vector<Scalar, Xsize>::Zero()),
-                _matPk(Eigen::Matrix<Scalar, Xsize, Xsize>::Zero()),
+                _matPk(),
                 _matK(Eigen::Matrix<Scalar, Xsize, Zsize>::Zero()),
-                _matFk(matFk), _matBk(matBk), _matQk(matQk), _matHk(matHk), _matRk(matRk) {}
+                _matFk(matFk), _matBk(matBk), _matQk(matQk), _matHk(matHk), _matRk(matRk),
+                _chi2(0), _chi2_gate(0), _chi2_gate1(0) {}
 
         void Reset() {
             _vecXhat = Eigen::Vector<Scalar, Xsize>::Zero();
@@ -67,7 +114,7 @@ namespace KalmanA {
             _vecZk = Eigen::Vector<Scalar, Zsize>::Zero();
 
             /*Middle matrix*/
-            _matPk = Eigen::Matrix<Scalar, Xsize, Xsize>::Zero();
+            _matPk.setZero();
             _matK = Eigen::Matrix<Scalar, Xsize, Zsize>::Zero();
 
             /*Const matrix*/
@@ -76,8 +123,271 @@ namespace KalmanA {
             _matQk = Eigen::Matrix<Scalar, Xsize, Xsize>::Zero();
             _matHk = Eigen::Matrix<Scalar, Zsize, Xsize>::Zero();
             _matRk = Eigen::Matrix<Scalar, Zsize, Zsize>::Zero();
+            _chi2 = 0;
+        }
+
+        /**
+         * x = f(x, u, dt), P = F·P·FT + Q, F = F_jac(x, u, dt) at the prior x.
+         * f returns Eigen::Vector<Scalar, Xsize>, F_jac an Xsize x Xsize matrix.
+         * Q is the discrete process noise of this step.
+         */
+        template<typename Func, typename Jac>
+        void Predict(Func &&f, Jac &&F_jac, const Eigen::Vector<Scalar, Usize> &u, Scalar dt) {
+            _vecUk = u;
+            _matFk = F_jac(_vecXhat, _vecUk, dt);
+            _vecXhat = f(_vecXhat, _vecUk, dt);
+            _matPk = _matPk.template congruence<Xsize>(_matFk);
+            _matPk.addDense(_matQk);
+        }
+
+        // As above, F by forward differentiation of f, which must be generic over the scalar of x and u
+        template<typename Func>
+        void Predict(Func &&f, const Eigen::Vector<Scalar, Usize> &u, Scalar dt) {
+            _vecUk = u;
+            Eigen::Vector<Scalar, Xsize> x;
+            Jacobian<Xsize, Xsize>([&](const auto &xd) {
+                using T = typename std::decay_t<decltype(xd)>::Scalar;
+                return f(xd, Eigen::Vector<T, Usize>(_vecUk.template cast<T>()), dt);
+            }, _vecXhat, x, _matFk);
+            _vecXhat = x;
+            _matPk = _matPk.template congruence<Xsize>(_matFk);
+            _matPk.addDense(_matQk);
+        }
+
+        /**
+         * Correct with z, h(x) the expected measurement, H = H_jac(x).
+         * h returns Eigen::Vector<Scalar, Zsize>, H_jac a Zsize x Xsize matrix.
+         * Returns 0 if applied, 0x01 if H·P·HT + R is not positive definite or
+         * the chi square is above the gate, x and P are unchanged then.
+         */
+        template<typename Func, typename Jac>
+        uint8_t Update(Func &&h, Jac &&H_jac, const Eigen::Vector<Scalar, Zsize> &z) {
+            _matHk = H_jac(_vecXhat);
+            return Correct(z, z - h(_vecXhat));
+        }
+
+        // As above, H by forward differentiation of h, which must be generic over the scalar of x
+        template<typename Func>
+        uint8_t Update(Func &&h, const Eigen::Vector<Scalar, Zsize> &z) {
+            Eigen::Vector<Scalar, Zsize> zhat;
+            Jacobian<Zsize, Xsize>(h, _vecXhat, zhat, _matHk);
+            return Correct(z, z - zhat);
+        }
+
+        /**
+         * Correct with z one component at a time, R must be diagonal.
+         * Every component is a scalar update: no factorization and P changes by a
+         * rank one term, about a third of the work of Update() for 3 components.
+         * Component i is skipped if v^2/s of its own is above SetChi2GateScalar().
+         * Returns a mask with bit i set for every skipped component, 0 if all were used.
+         */
+        template<typename Func, typename Jac>
+        uint32_t UpdateSequential(Func &&h, Jac &&H_jac, const Eigen::Vector<Scalar, Zsize> &z) {
+            _matHk = H_jac(_vecXhat);
+            return CorrectSequential(z, z - h(_vecXhat));
+        }
+
+        // As above, H by forward differentiation of h
+        template<typename Func>
+        uint32_t UpdateSequential(Func &&h, const Eigen::Vector<Scalar, Zsize> &z) {
+            Eigen::Vector<Scalar, Zsize> zhat;
+            Jacobian<Zsize, Xsize>(h, _vecXhat, zhat, _matHk);
+            return CorrectSequential(z, z - zhat);
+        }
+
+        const Eigen::Vector<Scalar, Xsize> &GetState() const { return _vecXhat; }
+
+        void SetState(const Eigen::Vector<Scalar, Xsize> &x) { _vecXhat = x; }
+
+        const matrixf::SymMatrix<Scalar, Xsize> &GetCovariance() const { return _matPk; }
+
+        // Upper triangle of a symmetric P
+        template<typename M>
+        void SetCovariance(const M &P) { _matPk.fromDense(P); }
+
+        void SetProcessNoise(const Eigen::Matrix<Scalar, Xsize, Xsize> &Q) { _matQk = Q; }
+
+        void SetMeasureNoise(const Eigen::Matrix<Scalar, Zsize, Zsize> &R) { _matRk = R; }
+
+        // Chi square gate of Update(), e.g. 7.81 for 95% with 3 measurements, 0 disables
+        void SetChi2Gate(Scalar gate) { _chi2_gate = gate; }
+
+        // Gate of one component in UpdateSequential(), e.g. 3.84 for 95%, 0 disables
+        void SetChi2GateScalar(Scalar gate) { _chi2_gate1 = gate; }
+
+        // Chi square of the last Update(), the sum over the components for UpdateSequential()
+        Scalar GetChi2() const { return _chi2; }
+
+    protected:
+        /**
+         * A = L·LT, the lower triangle of l is written and 1/L(i,i) kept in l_inv
+         * so the solves only multiply. Returns 0x01 if A is not positive definite.
+         * With floor > 0, A positive semidefinite up to rounding: a pivot below
+         * floor·A(i,i) is taken as zero, its column of L and l_inv(i) are set to 0
+         * so the solves leave that direction out.
+         */
+        template<uint32_t _size>
+        static uint8_t Cholesky(const matrixf::SymMatrix<Scalar, _size> &a, Scalar (&l)[_size][_size],
+                                Scalar (&l_inv)[_size], Scalar floor = 0) {
+            for (uint32_t i = 0; i < _size; i++) {
+                for (uint32_t j = 0; j <= i; j++) {
+                    Scalar acc = a(j, i);
+                    for (uint32_t k = 0; k < j; k++) { acc -= l[i][k] * l[j][k]; }
+                    if (i != j) {
+                        l[i][j] = acc * l_inv[j];
+                    } else if (acc > 0 && acc > floor * a(i, i)) {
+                        l[i][i] = std::sqrt(acc);
+                        l_inv[i] = Scalar(1) / l[i][i];
+                    } else if (floor > 0 && a(i, i) >= 0) {
+                        l[i][i] = 0;
+                        l_inv[i] = 0;
+                    } else {
+                        return 0x01;
+                    }
+                }
+            }
+            return 0;
         }
 
+        // Marks the plain kernels in Correct(), nothing is known about H
+        struct PatternDense {};
+
+        // No structural zeros, only to get the unrolled kernels
+        struct PatternFull {
+            static constexpr uint8_t at(uint32_t, uint32_t) { return matrixf::kAny; }
+        };
+
+        // Transpose of a Pattern of H
+        template<typename PatternH>
+        struct PatternHt {
+            static constexpr uint8_t at(uint32_t i, uint32_t j) { return PatternH::at(j, i); }
+        };
+
+        // I-K·H, the columns where H is zero are those of I
+        template<typename PatternH>
+        struct PatternIKH {
+            // Column j of H has a nonzero
+            static constexpr bool used(uint32_t j) {
+                for (uint32_t k = 0; k < Zsize; k++) {
+                    if (PatternH::at(k, j) != matrixf::kZero) { return true; }
+                }
+                return false;
+            }
+
+            static constexpr uint8_t at(uint32_t i, uint32_t j) {
+                return used(j) ? matrixf::kAny : (i == j ? matrixf::kOne : matrixf::kZero);
+            }
+        };
+
+        /**
+         * K = P·HT·S^-1, x += K·v, P = (I-K·H)·P·(I-K·H)T + K·R·KT with _matHk set and v = z - h(x).
+         * A Pattern of H (see SymMatrix::congruence()) skips its zeros in every product,
+         * with the same result as PatternDense as long as H is zero where the Pattern says so.
+         */
+        template<typename PatternH = PatternDense>
+        uint8_t Correct(const Eigen::Vector<Scalar, Zsize> &z, const Eigen::Vector<Scalar, Zsize> &v,
+                        PatternH = PatternH()) {
+            constexpr bool kDense = std::is_same_v<PatternH, PatternDense>;
+            _vecZk = z;
+            // S = H·P·HT + R, factorized once
+            matrixf::SymMatrix<Scalar, Zsize> sym_s;
+            if constexpr (kDense) {
+                sym_s = _matPk.template congruence<Zsize>(_matHk);
+            } else {
+                sym_s = _matPk.template congruence<Zsize>(_matHk, PatternH());
+            }
+            sym_s.addDense(_matRk);
+            // S = L·LT
+            Scalar l[Zsize][Zsize];
+            Scalar l_inv[Zsize];
+            if (Cholesky(sym_s, l, l_inv)) { return 0x01; }
+            // ChiSquare = vT·S^-1·v = |L^-1·v|^2
+            Scalar y[Zsize];
+            _chi2 = 0;
+            for (uint32_t i = 0; i < Zsize; i++) {
+                Scalar acc = v(i);
+                for (uint32_t k = 0; k < i; k++) { acc -= l[i][k] * y[k]; }
+                y[i] = acc * l_inv[i];
+                _chi2 += y[i] * y[i];
+            }
+            if (_chi2_gate > 0 && _chi2 > _chi2_gate) { return 0x01; }
+            // K = P·HT·S^-1 row by row through L, Eigen's solve of the Xsize right hand sides costs more
+            Eigen::Matrix<Scalar, Xsize, Zsize> mat_pht;
+            if constexpr (kDense) {
+                _matPk.template mult<Zsize>(_matHk.transpose(), mat_pht);
+            } else {
+                _matPk.template mult<Zsize>(_matHk.transpose(), mat_pht, PatternHt<PatternH>());
+            }
+            for (uint32_t r = 0; r < Xsize; r++) {
+                Scalar w[Zsize];
+                for (uint32_t i = 0; i < Zsize; i++) {
+                    Scalar acc = mat_pht(r, i);
+                    for (uint32_t k = 0; k < i; k++) { acc -= l[i][k] * w[k]; }
+                    w[i] = acc * l_inv[i];
+                }
+                for (uint32_t i = Zsize; i-- > 0;) {
+                    Scalar acc = w[i];
+                    for (uint32_t k = i + 1; k < Zsize; k++) { acc -= l[k][i] * _matK(r, k); }
+                    _matK(r, i) = acc * l_inv[i];
+                }
+            }
+            _vecXhat += _matK * v;
+            // Joseph form keeps P symmetric positive for any K
+            Eigen::Matrix<Scalar, Xsize, Xsize> mat_ikh = Eigen::Matrix<Scalar, Xsize, Xsize>::Identity();
+            if constexpr (kDense) {
+                mat_ikh -= _matK * _matHk;
+                _matPk = _matPk.template congruence<Xsize>(mat_ikh);
+            } else {
+                matrixf::small::unroll<Xsize>([&](auto j) MATRIX_LAMBDA_INLINE {
+                    if constexpr (PatternIKH<PatternH>::used(j)) {
+                        mat_ikh.col(j) -= _matK * _matHk.col(j);
+                    }
+                });
+                _matPk = _matPk.template congruence<Xsize>(mat_ikh, PatternIKH<PatternH>());
+            }
+            matrixf::SymMatrix<Scalar, Zsize> sym_r;
+            sym_r.fromDense(_matRk);
+            if constexpr (kDense) {
+                _matPk += sym_r.template congruence<Xsize>(_matK);
+            } else {
+                _matPk += sym_r.template congruence<Xsize>(_matK, PatternFull());
+            }
+            return 0;
+        }
+
+        // Scalar updates in turn, v = z - h(x) at the prior x
+        uint32_t CorrectSequential(const Eigen::Vector<Scalar, Zsize> &z, const Eigen::Vector<Scalar, Zsize> &v) {
+            static_assert(Zsize <= 32, "Skip mask holds 32 components");
+            _vecZk = z;
+            _chi2 = 0;
+            uint32_t skipped = 0;
+            Eigen::Vector<Scalar, Xsize> vec_dx = Eigen::Vector<Scalar, Xsize>::Zero();
+            Eigen::Vector<Scalar, Xsize> vec_pht;
+            for (uint32_t i = 0; i < Zsize; i++) {
+                // s = h·P·hT + r, the innovation sees the earlier components through h·dx
+                _matPk.template mult<1>(_matHk.row(i).transpose(), vec_pht);
+                Scalar s = _matHk.row(i).dot(vec_pht) + _matRk(i, i);
+                Scalar vi = v(i) - _matHk.row(i).dot(vec_dx);
+                _matK.col(i).setZero();
+                if (!(s > 0)) {
+                    skipped |= 1u << i;
+                    continue;
+                }
+                Scalar chi = vi * vi / s;
+                _chi2 += chi;
+                if (_chi2_gate1 > 0 && chi > _chi2_gate1) {
+                    skipped |= 1u << i;
+                    continue;
+                }
+                // k = P·hT/s, P -= s·k·kT
+                Scalar inv = Scalar(1) / s;
+                _matK.col(i) = vec_pht * inv;
+                vec_dx += _matK.col(i) * vi;
+                _matPk.template rankUpdate<1>(vec_pht, -inv);
+            }
+            _vecXhat += vec_dx;
+            return skipped;
+        }
     };
 };
 
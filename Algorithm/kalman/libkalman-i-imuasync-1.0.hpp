@@ -0,0 +1,193 @@
+/*
+ * @Description: Timestamp driven front end of the AHRS filters for sensors at different rates
+ * @Author: qianwan
+ * @Date: 2026-10-17 10:00:00
+ * @LastEditTime: 2026-10-17 10:00:00
+ * @LastEditors: qianwan
+ */
+/**
+ * EKF::cESEKF ahrs(1e-4, 1e-8, 1e-3);
+ * EKF::cImuAsync<EKF::cESEKF> front(ahrs, 2000);  // Wait up to 2 ms for late samples
+ * // Gyro interrupt, 1 kHz or faster
+ * front.PushGyro(t_us, gx, gy, gz);
+ * // Accelerometer interrupt, any other rate
+ * front.PushAccel(t_us, ax, ay, az);
+ * front.GetQuaternion(q);
+ *
+ * Every gyro sample propagates the filter over the time since the previous
+ * sample, an accelerometer sample first propagates to its own time with the
+ * last gyro rate and then corrects. Samples wait in a short buffer sorted by
+ * time until they are delay_us older than the newest one (or the buffer is
+ * full), so samples that arrive out of order within that window are used in
+ * order. A sample older than the filter time is dropped.
+ *
+ * GetQuaternion() integrates the gyro samples still in the buffer on top of
+ * the filter attitude, quaternion only, so the output lags the newest gyro
+ * sample, not the delay.
+ *
+ * Filter needs PredictGyro(gx, gy, gz, dt), CorrectAccel(ax, ay, az),
+ * Quaternion() and GetGyroBias(), like cESEKF.
+ * Timestamps are uint32_t microseconds and may wrap.
+ */
+#pragma once
+#ifndef LIB_KALMAN_IMUASYNC_
+#define LIB_KALMAN_IMUASYNC_
+
+#include <cstdint>
+#include <cstring>
+
+#include "../Eigen/Dense"
+#include "../Eigen/Geometry"
+
+namespace EKF {
+
+template<typename Filter, uint32_t _depth = 8>
+class cImuAsync {
+protected:
+    enum : uint8_t {
+        kGyro = 0,
+        kAccel = 1
+    };
+
+    struct Sample {
+        uint32_t t;         // us
+        uint8_t type;
+        float v[3];
+    };
+
+    Filter &_filter;
+    Sample _buf[_depth + 1];            // Sorted by time, oldest first, one spare for Push()
+    uint32_t _count;
+    uint32_t _delay;                    // us a sample waits for older ones
+    uint32_t _t_filter;                 // Time of the filter state
+    uint32_t _t_newest;
+    float _rate[3];                     // Last gyro sample used by the filter
+    uint32_t _late;                     // Dropped samples
+    uint32_t _rejected;                 // Corrections refused by the filter
+    uint8_t _started;
+    uint8_t _have_rate;
+
+    // a is before b, wrap safe for differences below 35 minutes
+    static bool Before(uint32_t a, uint32_t b) { return (int32_t) (a - b) < 0; }
+
+    static float Seconds(uint32_t from, uint32_t to) { return (float) (int32_t) (to - from) * 1e-6f; }
+
+    uint8_t Push(uint32_t t, uint8_t type, float x, float y, float z) {
+        // Dropped before anything moves, a late sample does not release others early
+        if (_started && Before(t, _t_filter)) {
+            _late++;
+            return 0x01;
+        }
+        // Insertion from the back, in order samples do not move anything
+        uint32_t i = _count;
+        while (i > 0 && Before(t, _buf[i - 1].t)) {
+            _buf[i] = _buf[i - 1];
+            i--;
+        }
+        _buf[i] = Sample{t, type, {x, y, z}};
+        _count++;
+        if (_count == 1 || Before(_t_newest, t)) {
+            _t_newest = t;
+        }
+        // Over full, the oldest of all goes, the new sample if it is the oldest
+        if (_count > _depth) {
+            Release();
+        }
+        while (_count > 0 && (uint32_t) (_t_newest - _buf[0].t) >= _delay) {
+            Release();
+        }
+        return 0;
+    }
+
+    // Run the oldest sample through the filter
+    void Release() {
+        const Sample &s = _buf[0];
+        if (!_started) {
+            _started = 1;
+            _t_filter = s.t;
+        }
+        float dt = Seconds(_t_filter, s.t);
+        if (s.type == kGyro) {
+            if (dt > 0) {
+                _filter.PredictGyro(s.v[0], s.v[1], s.v[2], dt);
+            }
+            memcpy(_rate, s.v, sizeof(_rate));
+            _have_rate = 1;
+        } else {
+            if (dt > 0 && _have_rate) {
+                _filter.PredictGyro(_rate[0], _rate[1], _rate[2], dt);
+            }
+            if (_filter.CorrectAccel(s.v[0], s.v[1], s.v[2])) {
+                _rejected++;
+            }
+        }
+        _t_filter = s.t;
+        _count--;
+        memmove(_buf, _buf + 1, sizeof(Sample) * _count);
+    }
+
+public:
+    explicit cImuAsync(Filter &filter, uint32_t delay_us = 0) : _filter(filter),
+                                                                _count(0),
+                                                                _delay(delay_us),
+                                                                _t_filter(0),
+                                                                _t_newest(0),
+                                                                _rate{0.0f, 0.0f, 0.0f},
+                                                                _late(0),
+                                                                _rejected(0),
+                                                                _started(0),
+                                                                _have_rate(0) {}
+
+    // Return 0x01 if the sample is older than the filter time and dropped
+    uint8_t PushGyro(uint32_t t_us, float gx, float gy, float gz) { return Push(t_us, kGyro, gx, gy, gz); }
+
+    uint8_t PushAccel(uint32_t t_us, float ax, float ay, float az) { return Push(t_us, kAccel, ax, ay, az); }
+
+    // Run every buffered sample through the filter, e.g. at the end of a log
+    void Flush() {
+        while (_count > 0) { Release(); }
+    }
+
+    // Attitude at the newest gyro sample, the buffered samples integrated on top of the filter
+    void GetQuaternion(float *qbuf) const {
+        Eigen::Quaternion<float> q = _filter.Quaternion().template cast<float>();
+        float bias[3];
+        _filter.GetGyroBias(bias);
+        float rate[3] = {_rate[0], _rate[1], _rate[2]};
+        uint8_t have_rate = _have_rate;
+        // Before the first Release() the filter has no time, start at the oldest sample
+        uint32_t t = (_started || _count == 0) ? _t_filter : _buf[0].t;
+        for (uint32_t i = 0; i < _count; i++) {
+            const Sample &s = _buf[i];
+            if (s.type == kGyro) {
+                memcpy(rate, s.v, sizeof(rate));
+                have_rate = 1;
+            }
+            if (have_rate) {
+                float half_dt = 0.5f * Seconds(t, s.t);
+                q = q * Eigen::Quaternion<float>(1.0f, (rate[0] - bias[0]) * half_dt,
+                                                 (rate[1] - bias[1]) * half_dt, (rate[2] - bias[2]) * half_dt);
+            }
+            t = s.t;
+        }
+        q.normalize();
+        qbuf[0] = q.w();
+        qbuf[1] = q.x();
+        qbuf[2] = q.y();
+        qbuf[3] = q.z();
+    }
+
+    void SetDelay(uint32_t delay_us) { _delay = delay_us; }
+
+    // Time of the filter state in us, the newest sample it has used
+    uint32_t FilterTime() const { return _t_filter; }
+
+    uint32_t LateCount() const { return _late; }
+
+    uint32_t RejectedCount() const { return _rejected; }
+
+    Filter &GetFilter() { return _filter; }
+};
+}  // namespace EKF
+
+#endif
@@ -13,6 +13,9 @@
 #ifndef LIB_KALMAN_IMUEKF_
 #define LIB_KALMAN_IMUEKF_
 
+#include <cstddef>
+#include <cstring>
+
 #include "../Eigen/Dense"
 #include "libkalman-1.0.hpp"
 
@@ -35,7 +38,8 @@ protected:
 
     Eigen::Vector<EKF_SCALAR, 1> _chiSquare;
     Eigen::Vector<EKF_SCALAR, 3> _vec_chi;
-    Eigen::Matrix<EKF_SCALAR, 3, 3> _mat_chi;
+    Eigen::Matrix<EKF_SCALAR, 3, 3> _mat_chi;   // Innovation covariance H·P·HT+R
+    Eigen::LLT<Eigen::Matrix<EKF_SCALAR, 3, 3>> _llt_chi;
     Eigen::Vector<EKF_SCALAR, 6> _vec_measure_correct;
 
     EKF_SCALAR _accel_norm;
@@ -45,6 +49,256 @@ protected:
     uint32_t _chi_square_err_cnt;
     uint8_t _chi_square_stable;
     uint8_t _chi_square_stable_once;
+    uint8_t _sequential;                // Correct one accelerometer axis at a time
+    uint8_t _sparse;                    // Skip the structural zeros of F and H
+
+    // Structure of F, H and I-K·H for the sparse kernels, see SymMatrix::congruence()
+    struct PatternF {
+        // Quaternion rows are full, bias rows are identity
+        static constexpr uint8_t at(uint32_t i, uint32_t j) {
+            return i < 4 ? matrixf::kAny : (i == j ? matrixf::kOne : matrixf::kZero);
+        }
+    };
+    struct PatternH {
+        // No bias columns
+        static constexpr uint8_t at(uint32_t, uint32_t j) { return j < 4 ? matrixf::kAny : matrixf::kZero; }
+    };
+    struct PatternHt {
+        static constexpr uint8_t at(uint32_t i, uint32_t j) { return PatternH::at(j, i); }
+    };
+    struct PatternIKH {
+        // K·H has no bias columns either
+        static constexpr uint8_t at(uint32_t i, uint32_t j) {
+            return j < 4 ? matrixf::kAny : (i == j ? matrixf::kOne : matrixf::kZero);
+        }
+    };
+
+    // h(x), gravity direction in the body frame, for any scalar so the Jacobian comes with it
+    template<typename T>
+    static Eigen::Vector<T, 3> MeasureModel(const Eigen::Vector<T, 6> &x) {
+        Eigen::Vector<T, 3> z;
+        z(0) = 2.0f * (x(1) * x(3) - x(0) * x(2));
+        z(1) = 2.0f * (x(0) * x(1) + x(2) * x(3));
+        z(2) = x(0) * x(0) - x(1) * x(1) - x(2) * x(2) + x(3) * x(3);
+        return z;
+    }
+
+    void InitCovariance() {
+        _matPk.fill(0.1f);
+        _matPk(0, 0) = 100000;
+        _matPk(1, 1) = 100000;
+        _matPk(2, 2) = 100000;
+        _matPk(3, 3) = 100000;
+        _matPk(4, 4) = 100;
+        _matPk(5, 5) = 100;
+    }
+
+    /**
+     * Blob of SaveState(), 128 bytes for whole flash words. The fields are
+     * copied in the byte order and float format of the machine, a blob is only
+     * read back by a build for the same target, not exchanged between ABIs.
+     */
+    struct StateBlob {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        float xhat[6];
+        float pk[21];                   // Packed upper triangle of P
+        uint32_t chi_square_err_cnt;
+        uint8_t chi_square_stable;
+        uint8_t chi_square_stable_once;
+        uint8_t reserved[2];
+        uint32_t crc;                   // CRC-32 of all bytes before it
+    };
+    static_assert(sizeof(StateBlob) == 128, "StateBlob layout changed, bump kStateVersion");
+
+    static constexpr uint32_t kStateMagic = 0x53464B45u;    // "EKFS"
+    static constexpr uint16_t kStateVersion = 1;
+
+    // CRC-32 (IEEE 802.3), bitwise as it runs once per boot
+    static uint32_t Crc32(const uint8_t *data, uint32_t len) {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (uint32_t i = 0; i < len; i++) {
+            crc ^= data[i];
+            for (uint32_t k = 0; k < 8; k++) { crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u))); }
+        }
+        return ~crc;
+    }
+
+    /**
+     * Step-3 to Step-5 on the whole measurement, _vec_chi holds z - h(x).
+     * _structured skips the zero columns of H, the result is the same to the bit.
+     */
+    template<bool _structured>
+    uint8_t CorrectDense(EKF_SCALAR dt) {
+        uint8_t skip_update_P = 0;
+
+        // A=H|k·P|k·HT|k+R|k, factorized once instead of inverted
+        matrixf::SymMatrix<EKF_SCALAR, 3> mat_s;
+        if constexpr (_structured) {
+            mat_s = _matPk.congruence<3>(_matHk, PatternH());
+        } else {
+            mat_s = _matPk.congruence<3>(_matHk);
+        }
+        mat_s.addDense(_matRk);
+        mat_s.toDense(_mat_chi);
+        _llt_chi.compute(_mat_chi);
+        // A not positive definite, the factor is garbage, skip the update like cKalmanA::Correct()
+        if (_llt_chi.info() != Eigen::Success) {
+            return 0x01;
+        }
+        // ChiSquare = VT·A^-1·V
+        _chiSquare(0) = _vec_chi.dot(_llt_chi.solve(_vec_chi));
+        EKF_SCALAR chi_val = _chiSquare(0);
+        // Through chi square, decide method to fusion data
+        _chi_square_stable_once = _chi_square_stable;
+        _chi_square_stable = (chi_val < 0.5 * _chi2threshold);
+        // Once converged and rk is big
+        if ((_chi_square_stable == 0) && _chi_square_stable_once) {
+            _stable ? _chi_square_err_cnt++ : _chi_square_err_cnt = 0;
+            if (_chi_square_err_cnt > 50) {
+                // Filter is divergence
+                _chi_square_stable_once = 0;
+                _chi_square_err_cnt = 0;
+                return 0x01;
+            }
+            skip_update_P = 1;  // Filter only update by predict. Measurement won't be used to correct xhat and P
+        } else                  // if divergent or rk is not that big/acceptable,use adaptive gain
+        {
+            if (chi_val > 0.1f * _chi2threshold && _chi_square_stable) {
+                _adaptive_gain_scale = (_chi2threshold - chi_val) / (0.9f * _chi2threshold);
+            } else {
+                // divergent need to rest
+                _adaptive_gain_scale = 1;
+            }
+        }
+        if (skip_update_P == 0) {
+            // Measurement value will be used to correct xhat and P
+            // Calculate K Xhat`|k P`|k
+            Eigen::Matrix<EKF_SCALAR, 6, 3> mat_pht;
+            if constexpr (_structured) {
+                _matPk.mult<3>(_matHk.transpose(), mat_pht, PatternHt());
+            } else {
+                _matPk.mult<3>(_matHk.transpose(), mat_pht);
+            }
+            // K = P·HT·A^-1 = (A^-1·H·P)T as A is symmetric, one row at a time through A = L·LT,
+            // Eigen's triangular solve of a 3x6 right hand side costs several times more
+            const Eigen::Matrix<EKF_SCALAR, 3, 3> &mat_l = _llt_chi.matrixLLT();
+            for (uint32_t i = 0; i < 6; i++) {
+                EKF_SCALAR y0 = mat_pht(i, 0) / mat_l(0, 0);
+                EKF_SCALAR y1 = (mat_pht(i, 1) - mat_l(1, 0) * y0) / mat_l(1, 1);
+                EKF_SCALAR y2 = (mat_pht(i, 2) - mat_l(2, 0) * y0 - mat_l(2, 1) * y1) / mat_l(2, 2);
+                EKF_SCALAR x2 = y2 / mat_l(2, 2);
+                EKF_SCALAR x1 = (y1 - mat_l(2, 1) * x2) / mat_l(1, 1);
+                EKF_SCALAR x0 = (y0 - mat_l(1, 0) * x1 - mat_l(2, 0) * x2) / mat_l(0, 0);
+                _matK(i, 0) = x0 * _adaptive_gain_scale;
+                _matK(i, 1) = x1 * _adaptive_gain_scale;
+                _matK(i, 2) = x2 * _adaptive_gain_scale;
+            }
+            _matK(4, 0) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
+            _matK(4, 1) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
+            _matK(4, 2) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
+            _matK(5, 0) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
+            _matK(5, 1) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
+            _matK(5, 2) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
+            // 计算修正值
+            _vec_measure_correct = _matK * (_vecZk - _matHk * _vecXhat);
+            // 零漂修正限幅,一般不会有过大的漂移
+            if (_vec_measure_correct(4) > 1e-2f * dt) {
+                _vec_measure_correct(4) = 1e-2f * dt;
+            } else if (_vec_measure_correct(4) < -1e-2f * dt) {
+                _vec_measure_correct(4) = -1e-2f * dt;
+            }
+            if (_vec_measure_correct(5) > 1e-2f * dt) {
+                _vec_measure_correct(5) = 1e-2f * dt;
+            } else if (_vec_measure_correct(5) < -1e-2f * dt) {
+                _vec_measure_correct(5) = -1e-2f * dt;
+            }
+            // Do not correct yaw data
+            _vec_measure_correct(3) = 0;
+            _vecXhat += _vec_measure_correct;
+
+            /*Step-5 Update P*/
+            // Joseph form, K is scaled so P|k - K·H|k·P|k would not stay symmetric positive
+            // P`|k = (I-K·H|k)·P|k·(I-K·H|k)T + K·R|k·KT
+            if constexpr (_structured) {
+                // Bias columns of I-K·H are those of I
+                Eigen::Matrix<EKF_SCALAR, 6, 6> mat_ikh = Eigen::Matrix<EKF_SCALAR, 6, 6>::Identity();
+                mat_ikh.leftCols<4>() -= _matK * _matHk.leftCols<4>();
+                _matPk = _matPk.congruence<6>(mat_ikh, PatternIKH());
+            } else {
+                Eigen::Matrix<EKF_SCALAR, 6, 6> mat_ikh = Eigen::Matrix<EKF_SCALAR, 6, 6>::Identity() - _matK * _matHk;
+                _matPk = _matPk.congruence<6>(mat_ikh);
+            }
+            _matPk.rankUpdate<3>(_matK, _r);
+        }
+        return 0;
+    }
+
+    /**
+     * Step-3 to Step-5 one accelerometer axis at a time, R is diagonal so every
+     * axis is a scalar update: no 3x3 factorization and P changes by rank one
+     * terms only. An axis whose own chi square is above the threshold is
+     * skipped; this gate replaces the adaptive gain scale of CorrectDense(),
+     * the divergence count runs on the summed chi square as before.
+     * The axes update a copy of P, kept only if the filter has not diverged.
+     */
+    uint8_t CorrectSequential(EKF_SCALAR dt) {
+        matrixf::SymMatrix<EKF_SCALAR, 6> mat_p = _matPk;
+        Eigen::Vector<EKF_SCALAR, 6> vec_dx = Eigen::Vector<EKF_SCALAR, 6>::Zero();
+        Eigen::Vector<EKF_SCALAR, 6> vec_pht;
+        Eigen::Vector<EKF_SCALAR, 6> vec_k;
+        EKF_SCALAR chi_val = 0;
+        for (uint32_t i = 0; i < 3; i++) {
+            // s = h·P·hT + r, innovations see the corrections of the previous axes through h·dx
+            if (_sparse) {
+                mat_p.mult<1>(_matHk.row(i).transpose(), vec_pht, PatternHt());
+            } else {
+                mat_p.mult<1>(_matHk.row(i).transpose(), vec_pht);
+            }
+            EKF_SCALAR s = _matHk.row(i).dot(vec_pht) + _r;
+            EKF_SCALAR hdx = _matHk.row(i).dot(vec_dx);
+            EKF_SCALAR v_chi = _vec_chi(i) - hdx;
+            // Correction innovation z - H·x like CorrectDense()
+            EKF_SCALAR v = _vecZk(i) - _matHk.row(i).dot(_vecXhat) - hdx;
+            EKF_SCALAR chi_i = v_chi * v_chi / s;
+            chi_val += chi_i;
+            _matK.col(i).setZero();
+            // Once converged, an axis far off the prediction is not used, like skip_update_P of CorrectDense()
+            if (_chi_square_stable && chi_i > 0.5f * _chi2threshold) {
+                continue;
+            }
+            // k = P·hT/s, bias rows shaped like CorrectDense()
+            vec_k = vec_pht / s;
+            vec_k(4) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
+            vec_k(5) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
+            _matK.col(i) = vec_k;
+            vec_dx += vec_k * v;
+            // Joseph form of a scalar update, P - k·phT - ph·kT + s·k·kT = P + s·(k - ph/s)(k - ph/s)T - ph·phT/s
+            mat_p.rankUpdate<1>(vec_k - vec_pht / s, s);
+            mat_p.rankUpdate<1>(vec_pht, -1.0f / s);
+        }
+        _chiSquare(0) = chi_val;
+        _chi_square_stable_once = _chi_square_stable;
+        _chi_square_stable = (chi_val < 0.5 * _chi2threshold);
+        if ((_chi_square_stable == 0) && _chi_square_stable_once) {
+            _stable ? _chi_square_err_cnt++ : _chi_square_err_cnt = 0;
+            if (_chi_square_err_cnt > 50) {
+                // Filter is divergence
+                _chi_square_stable_once = 0;
+                _chi_square_err_cnt = 0;
+                return 0x01;
+            }
+        }
+        // Same limits as CorrectDense()
+        vec_dx(4) = fmax(fmin(vec_dx(4), 1e-2f * dt), -1e-2f * dt);
+        vec_dx(5) = fmax(fmin(vec_dx(5), 1e-2f * dt), -1e-2f * dt);
+        vec_dx(3) = 0;
+        _vec_measure_correct = vec_dx;
+        _vecXhat += vec_dx;
+        _matPk = mat_p;
+        return 0;
+    }
 
 public:
     cEKF(EKF_SCALAR process_noise_quaternion,
@@ -55,41 +309,118 @@ public:
                                           _q2(process_noise_gyroscope),
                                           _r(process_noise_accelerometer),
                                           _lambda_inv(1.0f / fading_coefficient),
+                                          _chi2threshold(1e-8),
+                                          _adaptive_gain_scale(1),
                                           _stable(0),
                                           _chi_square_err_cnt(0),
+                                          _chi_square_stable(0),
                                           _chi_square_stable_once(0),
-                                          _chi2threshold(1e-8) {
+                                          _sequential(0),
+                                          _sparse(0) {
         _gyrobias[0] = 0.0f;
         _gyrobias[1] = 0.0f;
         _gyrobias[2] = 0.0f;
         _vecXhat << 1, 0, 0, 0, 0, 0;
         _matFk = Eigen::Matrix<EKF_SCALAR, 6, 6>::Identity();
-        _matPk << 100000, 0.1, 0.1, 0.1, 0.1, 0.1,
-            0.1, 100000, 0.1, 0.1, 0.1, 0.1,
-            0.1, 0.1, 100000, 0.1, 0.1, 0.1,
-            0.1, 0.1, 0.1, 100000, 0.1, 0.1,
-            0.1, 0.1, 0.1, 0.1, 100, 0.1,
-            0.1, 0.1, 0.1, 0.1, 0.1, 100;
+        InitCovariance();
     }
 
     void ResetEKF() {
         KalmanA::cKalmanA<EKF_SCALAR, 6, 1, 3>::Reset();
         _vecXhat << 1, 0, 0, 0, 0, 0;
         _matFk = Eigen::Matrix<EKF_SCALAR, 6, 6>::Identity();
-        _matPk << 100000, 0.1, 0.1, 0.1, 0.1, 0.1,
-            0.1, 100000, 0.1, 0.1, 0.1, 0.1,
-            0.1, 0.1, 100000, 0.1, 0.1, 0.1,
-            0.1, 0.1, 0.1, 100000, 0.1, 0.1,
-            0.1, 0.1, 0.1, 0.1, 100, 0.1,
-            0.1, 0.1, 0.1, 0.1, 0.1, 100;
+        InitCovariance();
         _stable = 0;
         _chi_square_err_cnt = 0;
+        _chi_square_stable = 0;
         _chi_square_stable_once = 0;
+        _adaptive_gain_scale = 1;
         _gyrobias[0] = 0.0f;
         _gyrobias[1] = 0.0f;
         _gyrobias[2] = 0.0f;
     }
 
+    // 1 for CorrectSequential(), 0 for CorrectDense()
+    void SetSequentialUpdate(uint8_t enable) {
+        _sequential = enable;
+    }
+
+    // 1 to skip the zero and identity blocks of F and H, same output as 0 to the bit
+    void SetSparseUpdate(uint8_t enable) {
+        _sparse = enable;
+    }
+
+    // Bytes SaveState() writes
+    static constexpr uint32_t StateSize() { return sizeof(StateBlob); }
+
+    /**
+     * Write quaternion, bias, P and the chi square state to buf, e.g. for a
+     * file on Linux or a flash page on target. Return the bytes written,
+     * 0 if size is below StateSize().
+     */
+    uint32_t SaveState(uint8_t *buf, uint32_t size) const {
+        if (size < sizeof(StateBlob)) {
+            return 0;
+        }
+        StateBlob blob;
+        memset(&blob, 0, sizeof(blob));
+        blob.magic = kStateMagic;
+        blob.version = kStateVersion;
+        blob.size = sizeof(StateBlob);
+        for (uint32_t i = 0; i < 6; i++) { blob.xhat[i] = (float) _vecXhat(i); }
+        for (uint32_t i = 0; i < 21; i++) { blob.pk[i] = (float) _matPk.data()[i]; }
+        blob.chi_square_err_cnt = _chi_square_err_cnt;
+        blob.chi_square_stable = _chi_square_stable;
+        blob.chi_square_stable_once = _chi_square_stable_once;
+        blob.crc = Crc32(reinterpret_cast<const uint8_t *>(&blob), offsetof(StateBlob, crc));
+        memcpy(buf, &blob, sizeof(blob));
+        return sizeof(blob);
+    }
+
+    /**
+     * Restart from a blob of SaveState(), the filter continues as it was saved.
+     * If the device may have moved while off, keep_attitude = 0 keeps only
+     * the bias and its variance and restarts the quaternion part like ResetEKF(),
+     * so a new attitude is found within a few steps.
+     * Returns 0x01 and changes nothing if the blob is short, corrupt or of
+     * another version.
+     */
+    uint8_t LoadState(const uint8_t *buf, uint32_t size, uint8_t keep_attitude = 1) {
+        StateBlob blob;
+        if (size < sizeof(StateBlob)) {
+            return 0x01;
+        }
+        memcpy(&blob, buf, sizeof(blob));
+        if (blob.magic != kStateMagic || blob.version != kStateVersion || blob.size != sizeof(StateBlob) ||
+            blob.crc != Crc32(buf, offsetof(StateBlob, crc))) {
+            return 0x01;
+        }
+        for (uint32_t i = 0; i < 6; i++) { _vecXhat(i) = blob.xhat[i]; }
+        for (uint32_t i = 0; i < 21; i++) { _matPk.data()[i] = blob.pk[i]; }
+        _chi_square_err_cnt = blob.chi_square_err_cnt;
+        _chi_square_stable = blob.chi_square_stable;
+        _chi_square_stable_once = blob.chi_square_stable_once;
+        if (!keep_attitude) {
+            EKF_SCALAR p44 = _matPk(4, 4), p45 = _matPk(4, 5), p55 = _matPk(5, 5);
+            InitCovariance();
+            _matPk(4, 4) = p44;
+            _matPk(4, 5) = p45;
+            _matPk(5, 5) = p55;
+            _vecXhat.head<4>() << 1, 0, 0, 0;
+            _chi_square_err_cnt = 0;
+            _chi_square_stable = 0;
+            _chi_square_stable_once = 0;
+        }
+        _quaternion[0] = _vecXhat(0);
+        _quaternion[1] = _vecXhat(1);
+        _quaternion[2] = _vecXhat(2);
+        _quaternion[3] = _vecXhat(3);
+        _gyrobias[0] = _vecXhat(4);
+        _gyrobias[1] = _vecXhat(5);
+        _gyrobias[2] = 0;
+        return 0;
+    }
+
     void GetQuaternion(float *qbuf) {
         memcpy(qbuf, _quaternion, sizeof(_quaternion));
     }
@@ -98,8 +429,6 @@ public:
     uint8_t
     UpdateQuaternion(EKF_SCALAR accelx, EKF_SCALAR accely, EKF_SCALAR accelz, EKF_SCALAR gyrox, EKF_SCALAR gyroy,
                      EKF_SCALAR gyroz, EKF_SCALAR dt) {
-        uint8_t skip_update_P = 0;
-
         EKF_SCALAR half_gx_dt, half_gy_dt, half_gz_dt;
 
         EKF_SCALAR norm_inverse;
@@ -180,26 +509,17 @@ public:
 
         /*Step-2 predict P*/
         // P|k = F|k·P`|k-1·FT|k + Q|k
-        _matPk = _matFk * _matPk * _matFk.transpose() + _matQk;
-        // 在工作点处计算观测函数h(x)的Jacobi矩阵H
-        tmp_value[0] = _vecXhat(0) * 2.0f;
-        tmp_value[1] = _vecXhat(1) * 2.0f;
-        tmp_value[2] = _vecXhat(2) * 2.0f;
-        tmp_value[3] = _vecXhat(3) * 2.0f;
-
-        _matHk <<
-                (-tmp_value[2]), tmp_value[3], (-tmp_value[0]), tmp_value[1], 0, 0,
-                tmp_value[1], tmp_value[0], tmp_value[3], tmp_value[2], 0, 0,
-                tmp_value[0], (-tmp_value[1]), (-tmp_value[2]), tmp_value[3], 0, 0;
+        if (_sparse) {
+            _matPk = _matPk.congruence<6>(_matFk, PatternF());
+        } else {
+            _matPk = _matPk.congruence<6>(_matFk);
+        }
+        _matPk.addDense(_matQk);
+        // 在工作点处计算观测函数h(x)及其Jacobi矩阵H, one pass of forward differentiation
+        KalmanA::Jacobian<3, 6>([](const auto &x) { return MeasureModel(x); }, _vecXhat, _vec_chi, _matHk);
 
         /*Step-3 Update K*/
         // K = P|k·HT|k/(H|k·P|k·HT|k+R|k)
-        // ChiSquare vector and matrix
-        //  V = z(k) - h(xhat)
-        _vec_chi(0) = 2.0f * (_vecXhat(1) * _vecXhat(3) - _vecXhat(0) * _vecXhat(2));
-        _vec_chi(1) = 2.0f * (_vecXhat(0) * _vecXhat(1) + _vecXhat(2) * _vecXhat(3));
-        _vec_chi(2) = _vecXhat(0) * _vecXhat(0) - _vecXhat(1) * _vecXhat(1) - _vecXhat(2) * _vecXhat(2) +
-                      _vecXhat(3) * _vecXhat(3);
         // 计算预测值和各个轴的方向余弦
         _orientation_cosine[0] = acos(abs(_vec_chi(0)));
         _orientation_cosine[1] = acos(abs(_vec_chi(1)));
@@ -207,82 +527,14 @@ public:
         // ChiSquare vector and matrix
         //  V = z(k) - h(xhat)
         _vec_chi = _vecZk - _vec_chi;
-        // A=(H|k·P|k·HT|k+R|k)^-1
-        _mat_chi = (_matHk * _matPk * _matHk.transpose() + _matRk).inverse();
-        // ChiSquare = VT·A·V
-        _chiSquare = _vec_chi.transpose() * _mat_chi * _vec_chi;
-        EKF_SCALAR chi_val = _chiSquare(0);
-        // Through chi square, decide method to fusion data
-        _chi_square_stable_once = _chi_square_stable;
-        _chi_square_stable = (chi_val < 0.5 * _chi2threshold);
-        // Once converged and rk is big
-        if ((_chi_square_stable == 0) && _chi_square_stable_once) {
-            _stable ? _chi_square_err_cnt++ : _chi_square_err_cnt = 0;
-            if (_chi_square_err_cnt > 50) {
-                // Filter is divergence
-                _chi_square_stable_once = 0;
-                _chi_square_err_cnt = 0;
-                return 0x01;
-            }
-            skip_update_P = 1;  // Filter only update by predict. Measurement won't be used to correct xhat and P
-        } else                  // if divergent or rk is not that big/acceptable,use adaptive gain
-        {
-            if (chi_val > 0.1f * _chi2threshold && _chi_square_stable) {
-                _adaptive_gain_scale = (_chi2threshold - chi_val) / (0.9f * _chi2threshold);
-            } else {
-                // divergent need to rest
-                _adaptive_gain_scale = 1;
-            }
+        uint8_t status;
+        if (_sequential) {
+            status = CorrectSequential(dt);
+        } else {
+            status = _sparse ? CorrectDense<true>(dt) : CorrectDense<false>(dt);
         }
-        if (skip_update_P == 0) {
-            // Measurement value will be used to correct xhat and P
-            // Calculate K Xhat`|k P`|k
-            _matK = _matPk * _matHk.transpose() * _mat_chi * _adaptive_gain_scale;
-            _matK(4, 0) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
-            _matK(4, 1) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
-            _matK(4, 2) *= _orientation_cosine[0] * 0.6366197723675813430755350534;
-            _matK(5, 0) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
-            _matK(5, 1) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
-            _matK(5, 2) *= _orientation_cosine[1] * 0.6366197723675813430755350534;
-            // 计算修正值
-            _vec_measure_correct = _matK * (_vecZk - _matHk * _vecXhat);
-            // 零漂修正限幅,一般不会有过大的漂移
-            if (_vec_measure_correct(4) > 1e-2f * dt) {
-                _vec_measure_correct(4) = 1e-2f * dt;
-            } else if (_vec_measure_correct(4) < -1e-2f * dt) {
-                _vec_measure_correct(4) = -1e-2f * dt;
-            }
-            if (_vec_measure_correct(5) > 1e-2f * dt) {
-                _vec_measure_correct(5) = 1e-2f * dt;
-            } else if (_vec_measure_correct(5) < -1e-2f * dt) {
-                _vec_measure_correct(5) = -1e-2f * dt;
-            }
-            // Do not correct yaw data
-            _vec_measure_correct(3) = 0;
-            _vecXhat += _vec_measure_correct;
-
-            /*Step-5 Update P*/
-            // P`|k = P|k - K·H|k·P|k
-            _matPk = _matPk - _matK * _matHk * _matPk;
-        }
-        // suppress filter excessive convergence
-        if (_matPk(0, 0) < 0) {
-            _matPk(0, 0) = 0;
-        }
-        if (_matPk(1, 1) < 0) {
-            _matPk(1, 1) = 0;
-        }
-        if (_matPk(2, 2) < 0) {
-            _matPk(2, 2) = 0;
-        }
-        if (_matPk(3, 3) < 0) {
-            _matPk(3, 3) = 0;
-        }
-        if (_matPk(4, 4) < 0) {
-            _matPk(4, 4) = 0;
-        }
-        if (_matPk(5, 5) < 0) {
-            _matPk(5, 5) = 0;
+        if (status) {
+            return status;
         }
 
         _quaternion[0] = _vecXhat(0);
@@ -295,6 +547,27 @@ public:
         
         return 0;
     }
+
+    /**
+     * UpdateQuaternion() over count samples, imu holds {ax, ay, az, gx, gy, gz, dt}
+     * per sample. out gets {q0, q1, q2, q3, bias x, bias y, bias z} per sample,
+     * the last good estimate for a failed one, and may be nullptr.
+     * Return the number of failed samples.
+     */
+    uint32_t UpdateBatch(const EKF_SCALAR *imu, uint32_t count, EKF_SCALAR *out) {
+        uint32_t failed = 0;
+        for (uint32_t i = 0; i < count; i++, imu += 7) {
+            if (UpdateQuaternion(imu[0], imu[1], imu[2], imu[3], imu[4], imu[5], imu[6])) {
+                failed++;
+            }
+            if (out != nullptr) {
+                memcpy(out, _quaternion, sizeof(_quaternion));
+                memcpy(out + 4, _gyrobias, sizeof(_gyrobias));
+                out += 7;
+            }
+        }
+        return failed;
+    }
 };
 }  // namespace EKF
 
@@ -0,0 +1,540 @@
+/**
+ ******************************************************************************
+ * @file    libkalman-i-imuekf-lockstep-1.0.hpp
+ * @brief   Many instances of the AHRS EKF of libkalman-i-imuekf-1.0.hpp
+ *          stepped in lockstep, one SIMD lane per instance.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Usage:
+ *      static EKF::cEKFLockstep<1024> fleet(10, 0.001, 10000000, 0.9996);
+ *      // accel[axis * 1024 + lane], gyro likewise
+ *      uint32_t diverged = fleet.UpdateQuaternion(accel, gyro, dt);
+ *      fleet.GetQuaternion(lane, q);
+ *
+ * Same model, gating and limits as cEKF, with the state of all instances
+ * stored as structure of arrays: element i of every instance is contiguous,
+ * P is the packed upper triangle. Instances are stepped kLanes at a time
+ * on GCC/clang vector types, which become SSE, AVX or NEON instructions, or
+ * on loops over the lanes with other compilers. The stable flag, the chi square state and the
+ * divergence count are kept per lane; where cEKF branches, both sides are
+ * computed and the lane takes one by a mask, so no lane waits for another.
+ *
+ * The structure of F and H is written out (bias rows of F are identity,
+ * bias columns of H are zero) and P is updated in Joseph form as
+ * P - K·H·P - (P - K·H·P)·HT·KT + r·K·KT, so results agree with cEKF to
+ * rounding, not to the bit. The divergence cosines use a polynomial acos
+ * (error below 1e-6), as libm's acos would not vectorize.
+ */
+
+#pragma once
+#ifndef LIB_KALMAN_IMUEKF_LOCKSTEP_
+#define LIB_KALMAN_IMUEKF_LOCKSTEP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "../matrix/matrix_small.h"
+#include "../matrix/matrix_sym.h"
+
+namespace EKF {
+
+namespace lockstep {
+
+    // Instances per step, a full AVX register, two of SSE or NEON
+    constexpr uint32_t kLanes = 8;
+
+#if defined(__GNUC__)
+    // GCC and clang vector extensions, lowered to SSE, AVX or NEON and to scalar code on Cortex-M
+    typedef float VecRaw __attribute__((vector_size(kLanes * sizeof(float))));
+    typedef int32_t MaskRaw __attribute__((vector_size(kLanes * sizeof(int32_t))));
+#define LOCKSTEP_LANEWISE(res, a, op, b) res = a op b;
+#define LOCKSTEP_COMPARE(res, a, op, b) res = a op b;
+#else
+    // Plain arrays, the operations are loops over the lanes for the auto vectorizer
+    template<typename T>
+    struct LaneArray {
+        T v[kLanes];
+
+        MATRIX_INLINE T &operator[](uint32_t l) { return v[l]; }
+
+        MATRIX_INLINE const T &operator[](uint32_t l) const { return v[l]; }
+    };
+    typedef LaneArray<float> VecRaw;
+    typedef LaneArray<int32_t> MaskRaw;
+#define LOCKSTEP_LANEWISE(res, a, op, b) for (uint32_t l = 0; l < kLanes; l++) { res[l] = a[l] op b[l]; }
+#define LOCKSTEP_COMPARE(res, a, op, b) for (uint32_t l = 0; l < kLanes; l++) { res[l] = -(int32_t) (a[l] op b[l]); }
+#endif
+
+    // Per lane flag, all bits set or clear like the result of a vector compare
+    struct Mask {
+        MaskRaw m;
+
+        MATRIX_INLINE Mask operator&(const Mask &b) const {
+            Mask res;
+            LOCKSTEP_LANEWISE(res.m, m, &, b.m)
+            return res;
+        }
+
+        MATRIX_INLINE Mask operator|(const Mask &b) const {
+            Mask res;
+            LOCKSTEP_LANEWISE(res.m, m, |, b.m)
+            return res;
+        }
+
+        MATRIX_INLINE Mask operator~() const {
+            Mask res;
+            LOCKSTEP_LANEWISE(res.m, m, ^, Mask::All().m)
+            return res;
+        }
+
+        MATRIX_INLINE bool at(uint32_t l) const { return m[l] != 0; }
+
+        static MATRIX_INLINE Mask All() {
+            Mask res;
+            for (uint32_t l = 0; l < kLanes; l++) { res.m[l] = -1; }
+            return res;
+        }
+    };
+
+    // One float per lane, operators work lane by lane
+    struct Vec {
+        VecRaw v;
+
+        Vec() = default;
+
+        MATRIX_INLINE Vec(float s) {  // NOLINT(google-explicit-constructor)
+            for (uint32_t l = 0; l < kLanes; l++) { v[l] = s; }
+        }
+
+        static MATRIX_INLINE Vec Load(const float *p) {
+            Vec res;
+            memcpy(&res.v, p, sizeof(res.v));
+            return res;
+        }
+
+        MATRIX_INLINE void Store(float *p) const { memcpy(p, &v, sizeof(v)); }
+
+#define LOCKSTEP_BINARY_OP(op)                                                                                   \
+        MATRIX_INLINE Vec operator op(const Vec &b) const {                                                     \
+            Vec res;                                                                                             \
+            LOCKSTEP_LANEWISE(res.v, v, op, b.v)                                                                 \
+            return res;                                                                                          \
+        }
+        LOCKSTEP_BINARY_OP(+)
+        LOCKSTEP_BINARY_OP(-)
+        LOCKSTEP_BINARY_OP(*)
+        LOCKSTEP_BINARY_OP(/)
+#undef LOCKSTEP_BINARY_OP
+
+#define LOCKSTEP_COMPARE_OP(op)                                                                                  \
+        MATRIX_INLINE Mask operator op(const Vec &b) const {                                                    \
+            Mask res;                                                                                            \
+            LOCKSTEP_COMPARE(res.m, v, op, b.v)                                                                  \
+            return res;                                                                                          \
+        }
+        LOCKSTEP_COMPARE_OP(<)
+        LOCKSTEP_COMPARE_OP(>)
+#undef LOCKSTEP_COMPARE_OP
+
+        MATRIX_INLINE Vec operator-() const { return Vec(0.0f) - *this; }
+    };
+
+    MATRIX_INLINE Vec operator*(float s, const Vec &a) { return Vec(s) * a; }
+
+    // mask ? a : b lane by lane, a bitwise blend
+    MATRIX_INLINE Mask Select(const Mask &mask, const Mask &a, const Mask &b) {
+        return (mask & a) | (~mask & b);
+    }
+
+    MATRIX_INLINE Vec Select(const Mask &mask, const Vec &a, const Vec &b) {
+        Mask ma, mb;
+        memcpy(&ma.m, &a.v, sizeof(ma.m));
+        memcpy(&mb.m, &b.v, sizeof(mb.m));
+        Mask blend = Select(mask, ma, mb);
+        Vec res;
+        memcpy(&res.v, &blend.m, sizeof(res.v));
+        return res;
+    }
+
+    MATRIX_INLINE Vec Sqrt(const Vec &a) {
+        Vec res;
+        for (uint32_t l = 0; l < kLanes; l++) { res.v[l] = std::sqrt(a.v[l]); }
+        return res;
+    }
+
+    MATRIX_INLINE Vec Abs(const Vec &a) {
+        Vec res;
+        for (uint32_t l = 0; l < kLanes; l++) { res.v[l] = std::fabs(a.v[l]); }
+        return res;
+    }
+
+    MATRIX_INLINE Vec Min(const Vec &a, const Vec &b) { return Select(b < a, b, a); }
+
+    MATRIX_INLINE Vec Max(const Vec &a, const Vec &b) { return Select(a < b, b, a); }
+
+    // acos of x in [0, 1], Abramowitz and Stegun 4.4.46
+    MATRIX_INLINE Vec Acos01(const Vec &x) {
+        Vec p = -0.0012624911f * x + 0.0066700901f;
+        p = p * x - 0.0170881256f;
+        p = p * x + 0.0308918810f;
+        p = p * x - 0.0501743046f;
+        p = p * x + 0.0889789874f;
+        p = p * x - 0.2145988016f;
+        p = p * x + 1.5707963050f;
+        return Sqrt(Vec(1.0f) - x) * p;
+    }
+
+#undef LOCKSTEP_LANEWISE
+#undef LOCKSTEP_COMPARE
+
+}  // namespace lockstep
+
+template<uint32_t _count>
+class cEKFLockstep {
+protected:
+    using Vec = lockstep::Vec;
+    using Mask = lockstep::Mask;
+    static constexpr uint32_t kLanes = lockstep::kLanes;
+    // Storage is padded to whole steps, the padding lanes run on dummy input
+    static constexpr uint32_t kPadded = (_count + kLanes - 1) / kLanes * kLanes;
+
+    // Offset of P(i,j) in the packed upper triangle
+    static constexpr uint32_t P(uint32_t i, uint32_t j) {
+        return i <= j ? matrixf::SymMatrix<float, 6>::index(i, j) : matrixf::SymMatrix<float, 6>::index(j, i);
+    }
+
+    float _q1;                          // process_noise_quaternion
+    float _q2;                          // process_noise_gyroscope
+    float _r;                           // process_noise_accelerometer
+    float _lambda_inv;                  // fading coefficient inverse
+    float _chi2threshold;               // Chi square testing threshold
+
+    float _xhat[6][kPadded];
+    float _pk[21][kPadded];             // Packed upper triangle of P
+    float _quaternion[4][kPadded];
+    float _gyrobias[2][kPadded];        // z bias is not estimated
+    float _chi_square[kPadded];
+    int32_t _chi_square_stable[kPadded];  // Lane masks, all bits set once the chi square was small
+    int32_t _chi_square_err_cnt[kPadded];
+    uint8_t _status[kPadded];           // 0x01 if the lane diverged or skipped the correction in the last step
+
+    void InitLanes() {
+        for (uint32_t b = 0; b < kPadded; b++) {
+            _xhat[0][b] = 1.0f;
+            for (uint32_t i = 1; i < 6; i++) { _xhat[i][b] = 0.0f; }
+            for (uint32_t i = 0; i < 6; i++) {
+                for (uint32_t j = i; j < 6; j++) {
+                    _pk[P(i, j)][b] = (i != j) ? 0.1f : (i < 4 ? 100000.0f : 100.0f);
+                }
+            }
+            _quaternion[0][b] = 1.0f;
+            _quaternion[1][b] = 0.0f;
+            _quaternion[2][b] = 0.0f;
+            _quaternion[3][b] = 0.0f;
+            _gyrobias[0][b] = 0.0f;
+            _gyrobias[1][b] = 0.0f;
+            _chi_square[b] = 0.0f;
+            _chi_square_stable[b] = 0;
+            _chi_square_err_cnt[b] = 0;
+            _status[b] = 0;
+        }
+    }
+
+    // Lanes b..b+kLanes of an SoA input row, the padding lanes read fill
+    static MATRIX_INLINE Vec LoadInput(const float *row, uint32_t b, float fill) {
+        if (b + kLanes <= _count) { return Vec::Load(row + b); }
+        Vec res(fill);
+        for (uint32_t l = 0; b + l < _count; l++) { res.v[l] = row[b + l]; }
+        return res;
+    }
+
+    // One step of lanes b..b+kLanes, see cEKF::UpdateQuaternion() for the steps
+    MATRIX_INLINE uint32_t StepLanes(uint32_t b, const float *accel, const float *gyro, float dt) {
+        Vec ax = LoadInput(accel, b, 0.0f);
+        Vec ay = LoadInput(accel + _count, b, 0.0f);
+        Vec az = LoadInput(accel + 2 * _count, b, 9.8f);
+        Vec gx = LoadInput(gyro, b, 0.0f) - Vec::Load(_gyrobias[0] + b);
+        Vec gy = LoadInput(gyro + _count, b, 0.0f) - Vec::Load(_gyrobias[1] + b);
+        Vec gz = LoadInput(gyro + 2 * _count, b, 0.0f);
+        Vec x[6];
+        for (uint32_t i = 0; i < 6; i++) { x[i] = Vec::Load(_xhat[i] + b); }
+        Vec p[21];
+        for (uint32_t i = 0; i < 21; i++) { p[i] = Vec::Load(_pk[i] + b); }
+
+        Vec hx = 0.5f * gx * dt;
+        Vec hy = 0.5f * gy * dt;
+        Vec hz = 0.5f * gz * dt;
+        // Quaternion block of F, the bias block is filled after predicting x
+        Vec f[4][6] = {{1.0f, -hx, -hy, -hz, 0.0f, 0.0f},
+                       {hx, 1.0f, hz, -hy, 0.0f, 0.0f},
+                       {hy, -hz, 1.0f, hx, 0.0f, 0.0f},
+                       {hz, hy, -hx, 1.0f, 0.0f, 0.0f}};
+
+        Vec accel_norm = Sqrt(ax * ax + ay * ay + az * az);
+        Vec gyro_norm = Sqrt(gx * gx + gy * gy + gz * gz);
+        Mask stable = (gyro_norm < Vec(0.3f)) & (Abs(accel_norm - Vec(9.8f)) < Vec(0.5f));
+        Vec norm_inverse = Vec(1.0f) / accel_norm;
+        Vec z[3] = {ax * norm_inverse, ay * norm_inverse, az * norm_inverse};
+
+        /*Step-1 predict xhat*/
+        Vec xp[4];
+        for (uint32_t i = 0; i < 4; i++) {
+            xp[i] = f[i][0] * x[0] + f[i][1] * x[1] + f[i][2] * x[2] + f[i][3] * x[3];
+        }
+        Vec t[4];
+        for (uint32_t i = 0; i < 4; i++) { t[i] = xp[i] * dt * 0.5f; }
+        f[0][4] = t[1];
+        f[0][5] = t[2];
+        f[1][4] = -t[0];
+        f[1][5] = t[3];
+        f[2][4] = -t[3];
+        f[2][5] = -t[0];
+        f[3][4] = t[2];
+        f[3][5] = -t[1];
+        // Fade and limit the bias variance
+        p[P(4, 4)] = Min(p[P(4, 4)] * _lambda_inv, Vec(10000.0f));
+        p[P(5, 5)] = Min(p[P(5, 5)] * _lambda_inv, Vec(10000.0f));
+        norm_inverse = Vec(1.0f) / Sqrt(xp[0] * xp[0] + xp[1] * xp[1] + xp[2] * xp[2] + xp[3] * xp[3]);
+        // cEKF scales the whole state, biases included
+        for (uint32_t i = 0; i < 4; i++) { x[i] = xp[i] * norm_inverse; }
+        x[4] = x[4] * norm_inverse;
+        x[5] = x[5] * norm_inverse;
+
+        /*Step-2 predict P*/
+        // F·P, the bias rows of F are identity
+        // Unrolled, so the packed offsets are constants and the lanes stay in registers
+        Vec fp[4][6];
+        matrixf::small::unroll<4>([&](auto i) MATRIX_LAMBDA_INLINE {
+            matrixf::small::unroll<6>([&](auto j) MATRIX_LAMBDA_INLINE {
+                Vec acc = f[i][0] * p[P(0, j)];
+                matrixf::small::unroll<5>([&](auto k) MATRIX_LAMBDA_INLINE {
+                    acc = acc + f[i][k + 1] * p[P(k + 1, j)];
+                });
+                fp[i][j] = acc;
+            });
+        });
+        // (F·P)·FT, rows 4 and 5 of F·P are those of P
+        matrixf::small::unroll<6>([&](auto i) MATRIX_LAMBDA_INLINE {
+            matrixf::small::unroll<6>([&](auto j) MATRIX_LAMBDA_INLINE {
+                if constexpr (j >= i && j < 4) {
+                    Vec acc = fp[i][0] * f[j][0];
+                    matrixf::small::unroll<5>([&](auto k) MATRIX_LAMBDA_INLINE {
+                        acc = acc + fp[i][k + 1] * f[j][k + 1];
+                    });
+                    p[P(i, j)] = acc;
+                } else if constexpr (j >= i && i < 4) {
+                    p[P(i, j)] = fp[i][j];
+                }
+            });
+        });
+        matrixf::small::unroll<4>([&](auto i) MATRIX_LAMBDA_INLINE { p[P(i, i)] = p[P(i, i)] + _q1 * dt; });
+        p[P(4, 4)] = p[P(4, 4)] + _q2 * dt;
+        p[P(5, 5)] = p[P(5, 5)] + _q2 * dt;
+
+        // h(x) and H, gravity in the body frame, H has no bias columns
+        Vec hxk[3] = {2.0f * (x[1] * x[3] - x[0] * x[2]),
+                      2.0f * (x[0] * x[1] + x[2] * x[3]),
+                      x[0] * x[0] - x[1] * x[1] - x[2] * x[2] + x[3] * x[3]};
+        Vec h[3][4] = {{-2.0f * x[2], 2.0f * x[3], -2.0f * x[0], 2.0f * x[1]},
+                       {2.0f * x[1], 2.0f * x[0], 2.0f * x[3], 2.0f * x[2]},
+                       {2.0f * x[0], -2.0f * x[1], -2.0f * x[2], 2.0f * x[3]}};
+        Vec cos0 = Acos01(Abs(hxk[0]));
+        Vec cos1 = Acos01(Abs(hxk[1]));
+        Vec v[3];
+        for (uint32_t k = 0; k < 3; k++) { v[k] = z[k] - hxk[k]; }
+
+        /*Step-3 Update K*/
+        // P·HT and A = H·P·HT + R
+        Vec pht[6][3];
+        matrixf::small::unroll<6>([&](auto i) MATRIX_LAMBDA_INLINE {
+            for (uint32_t k = 0; k < 3; k++) {
+                pht[i][k] = p[P(i, 0)] * h[k][0] + p[P(i, 1)] * h[k][1] + p[P(i, 2)] * h[k][2] +
+                            p[P(i, 3)] * h[k][3];
+            }
+        });
+        Vec s[3][3];
+        for (uint32_t k = 0; k < 3; k++) {
+            for (uint32_t m = k; m < 3; m++) {
+                s[k][m] = h[k][0] * pht[0][m] + h[k][1] * pht[1][m] + h[k][2] * pht[2][m] + h[k][3] * pht[3][m];
+            }
+            s[k][k] = s[k][k] + _r;
+        }
+        // A = L·LT, a lane with a pivot not above 0 skips the correction like cEKF
+        Vec d0 = s[0][0];
+        Vec l00 = Sqrt(d0);
+        Vec l10 = s[0][1] / l00;
+        Vec l20 = s[0][2] / l00;
+        Vec d1 = s[1][1] - l10 * l10;
+        Vec l11 = Sqrt(d1);
+        Vec l21 = (s[1][2] - l20 * l10) / l11;
+        Vec d2 = s[2][2] - l20 * l20 - l21 * l21;
+        Vec l22 = Sqrt(d2);
+        Mask pd = (d0 > Vec(0.0f)) & (d1 > Vec(0.0f)) & (d2 > Vec(0.0f));
+        // ChiSquare = VT·A^-1·V = |L^-1·V|^2
+        Vec y0 = v[0] / l00;
+        Vec y1 = (v[1] - l10 * y0) / l11;
+        Vec y2 = (v[2] - l20 * y0 - l21 * y1) / l22;
+        Vec chi = y0 * y0 + y1 * y1 + y2 * y2;
+
+        // Chi square state machine of cEKF, both branches under masks
+        Mask stable_once;
+        memcpy(&stable_once.m, _chi_square_stable + b, sizeof(stable_once.m));
+        Mask chi_stable = chi < Vec(0.5f * _chi2threshold);
+        Mask hold = ~chi_stable & stable_once;
+        // The counter only moves in held lanes, kept as plain lanes
+        int32_t err_cnt[kLanes];
+        memcpy(err_cnt, _chi_square_err_cnt + b, sizeof(err_cnt));
+        Mask diverge;
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int32_t cnt = stable.at(l) ? err_cnt[l] + 1 : 0;
+            cnt = hold.at(l) ? cnt : err_cnt[l];
+            diverge.m[l] = (hold.at(l) && cnt > 50) ? -1 : 0;
+            err_cnt[l] = diverge.at(l) ? 0 : cnt;
+        }
+        // Lanes without a factor leave the chi square state as it was
+        chi_stable = Select(pd, chi_stable, stable_once);
+        for (uint32_t l = 0; l < kLanes; l++) {
+            if (!pd.at(l)) {
+                err_cnt[l] = _chi_square_err_cnt[b + l];
+                diverge.m[l] = 0;
+            }
+        }
+        Mask update = ~hold & pd;
+        Vec gain = Select((chi > Vec(0.1f * _chi2threshold)) & chi_stable,
+                          (Vec(_chi2threshold) - chi) / (0.9f * _chi2threshold), Vec(1.0f));
+
+        // K = P·HT·A^-1 row by row, bias rows shaped by the axis cosines
+        Vec k[6][3];
+        Vec inv00 = Vec(1.0f) / l00;
+        Vec inv11 = Vec(1.0f) / l11;
+        Vec inv22 = Vec(1.0f) / l22;
+        for (uint32_t i = 0; i < 6; i++) {
+            Vec w0 = pht[i][0] * inv00;
+            Vec w1 = (pht[i][1] - l10 * w0) * inv11;
+            Vec w2 = (pht[i][2] - l20 * w0 - l21 * w1) * inv22;
+            k[i][2] = w2 * inv22;
+            k[i][1] = (w1 - l21 * k[i][2]) * inv11;
+            k[i][0] = (w0 - l10 * k[i][1] - l20 * k[i][2]) * inv00;
+            Vec scale = gain;
+            if (i == 4) { scale = scale * (cos0 * 0.6366197723675814f); }
+            if (i == 5) { scale = scale * (cos1 * 0.6366197723675814f); }
+            for (uint32_t m = 0; m < 3; m++) { k[i][m] = k[i][m] * scale; }
+        }
+        // Correction from z - H·x, bias limited and yaw untouched
+        Vec r[3];
+        for (uint32_t m = 0; m < 3; m++) {
+            r[m] = z[m] - (h[m][0] * x[0] + h[m][1] * x[1] + h[m][2] * x[2] + h[m][3] * x[3]);
+        }
+        Vec dx[6];
+        for (uint32_t i = 0; i < 6; i++) { dx[i] = k[i][0] * r[0] + k[i][1] * r[1] + k[i][2] * r[2]; }
+        Vec bias_limit = Vec(1e-2f * dt);
+        dx[4] = Max(Min(dx[4], bias_limit), -bias_limit);
+        dx[5] = Max(Min(dx[5], bias_limit), -bias_limit);
+        dx[3] = 0.0f;
+
+        /*Step-5 Update P*/
+        // Joseph form with (I-K·H)·P = P - K·(H·P), H·P = (P·HT)T
+        Vec ap[6][6];
+        matrixf::small::unroll<6>([&](auto i) MATRIX_LAMBDA_INLINE {
+            matrixf::small::unroll<6>([&](auto j) MATRIX_LAMBDA_INLINE {
+                ap[i][j] = p[P(i, j)] - (k[i][0] * pht[j][0] + k[i][1] * pht[j][1] + k[i][2] * pht[j][2]);
+            });
+        });
+        // P` = AP - (AP·HT)·KT + r·K·KT = AP + (r·K - AP·HT)·KT
+        Vec c[6][3];
+        for (uint32_t i = 0; i < 6; i++) {
+            for (uint32_t m = 0; m < 3; m++) {
+                c[i][m] = _r * k[i][m] -
+                          (ap[i][0] * h[m][0] + ap[i][1] * h[m][1] + ap[i][2] * h[m][2] + ap[i][3] * h[m][3]);
+            }
+        }
+        matrixf::small::unroll<6>([&](auto i) MATRIX_LAMBDA_INLINE {
+            matrixf::small::unroll<6>([&](auto j) MATRIX_LAMBDA_INLINE {
+                if constexpr (j >= i) {
+                    Vec pn = ap[i][j] + c[i][0] * k[j][0] + c[i][1] * k[j][1] + c[i][2] * k[j][2];
+                    p[P(i, j)] = Select(update, pn, p[P(i, j)]);
+                }
+            });
+        });
+        for (uint32_t i = 0; i < 6; i++) { x[i] = Select(update, x[i] + dx[i], x[i]); }
+
+        // Store, outputs keep the last good estimate of a diverged or unfactorized lane
+        Mask failed = diverge | ~pd;
+        for (uint32_t i = 0; i < 6; i++) { x[i].Store(_xhat[i] + b); }
+        for (uint32_t i = 0; i < 21; i++) { p[i].Store(_pk[i] + b); }
+        for (uint32_t i = 0; i < 4; i++) {
+            Select(failed, Vec::Load(_quaternion[i] + b), x[i]).Store(_quaternion[i] + b);
+        }
+        Select(failed, Vec::Load(_gyrobias[0] + b), x[4]).Store(_gyrobias[0] + b);
+        Select(failed, Vec::Load(_gyrobias[1] + b), x[5]).Store(_gyrobias[1] + b);
+        Select(pd, chi, Vec::Load(_chi_square + b)).Store(_chi_square + b);
+        memcpy(_chi_square_stable + b, &chi_stable.m, sizeof(chi_stable.m));
+        memcpy(_chi_square_err_cnt + b, err_cnt, sizeof(err_cnt));
+        uint32_t diverged = 0;
+        for (uint32_t l = 0; l < kLanes && b + l < _count; l++) {
+            _status[b + l] = failed.at(l) ? 0x01 : 0x00;
+            diverged += failed.at(l);
+        }
+        return diverged;
+    }
+
+public:
+    cEKFLockstep(float process_noise_quaternion,
+                 float process_noise_gyroscope,
+                 float process_noise_accelerometer,
+                 float fading_coefficient) : _q1(process_noise_quaternion),
+                                             _q2(process_noise_gyroscope),
+                                             _r(process_noise_accelerometer),
+                                             _lambda_inv(1.0f / fading_coefficient),
+                                             _chi2threshold(1e-8f) {
+        InitLanes();
+    }
+
+    void ResetEKF() {
+        InitLanes();
+    }
+
+    // Number of instances
+    uint32_t count() const { return _count; }
+
+    /**
+     * One step of every instance, accel[axis * _count + lane] in m/s^2 and
+     * gyro[axis * _count + lane] in rad/s. Return the number of instances
+     * that diverged or skipped the correction in this step, see GetStatus().
+     */
+    uint32_t UpdateQuaternion(const float *accel, const float *gyro, float dt) {
+        uint32_t diverged = 0;
+        for (uint32_t b = 0; b < kPadded; b += kLanes) { diverged += StepLanes(b, accel, gyro, dt); }
+        return diverged;
+    }
+
+    void GetQuaternion(uint32_t lane, float *qbuf) const {
+        for (uint32_t i = 0; i < 4; i++) { qbuf[i] = _quaternion[i][lane]; }
+    }
+
+    // Component i of the quaternion of all instances
+    const float *Quaternion(uint32_t i) const { return _quaternion[i]; }
+
+    void GetGyroBias(uint32_t lane, float *bias) const {
+        bias[0] = _gyrobias[0][lane];
+        bias[1] = _gyrobias[1][lane];
+        bias[2] = 0.0f;
+    }
+
+    float GetChiSquare(uint32_t lane) const { return _chi_square[lane]; }
+
+    // 0x01 if the instance diverged or A was not positive definite in the last step, like cEKF::UpdateQuaternion()
+    uint8_t GetStatus(uint32_t lane) const { return _status[lane]; }
+};
+
+}  // namespace EKF
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * @Description: Error state (multiplicative) kalman filter of AHRS
+ * @Author: qianwan
+ * @Date: 2026-10-17 10:00:00
+ * @LastEditTime: 2026-10-17 10:00:00
+ * @LastEditors: qianwan
+ */
+/**
+ * EKF::cESEKF myesekf(1e-4, 1e-8, 1e-3);
+ * myesekf.UpdateQuaternion(ax, ay, az, gx, gy, gz, dt);
+ * myesekf.GetQuaternion(q);
+ *
+ * The quaternion and the gyro bias are the nominal state and are propagated
+ * directly. The filter state is the error: a 3-D attitude error dθ in the
+ * body frame, q_true = q ⊗ [1, dθ/2], and a 3-axis bias error db. After a
+ * correction the error is folded into q and b and set back to zero, so P is
+ * 6x6 like cEKF, but without the redundant quaternion norm direction, and
+ * all three bias axes are estimated.
+ *
+ * Error model, ω = gyro - b:
+ *      dθ` = (I - [ω·dt]x)·dθ - dt·db,  db` = db
+ *      z   = accel/|accel| = RT·[0,0,1] = g,  H = [[g]x, 0]
+ * The z axis bias is observable only while the body is tilted, with gravity
+ * alone the heading error is not observable and P of it grows with the noise.
+ * F and H are only partly filled, the kernels skip the zeros of both.
+ */
+#pragma once
+#ifndef LIB_KALMAN_IMUESEKF_
+#define LIB_KALMAN_IMUESEKF_
+
+#include <cmath>
+#include <cstring>
+
+#include "../Eigen/Dense"
+#include "../Eigen/Geometry"
+#include "libkalman-1.0.hpp"
+#include "libkalman-i-imupreint-1.0.hpp"
+
+#ifndef EKF_SCALAR
+#define EKF_SCALAR float
+#endif
+namespace EKF {
+
+class cESEKF : public KalmanA::cKalmanA<EKF_SCALAR, 6, 3, 3> {
+protected:
+    typedef KalmanA::cKalmanA<EKF_SCALAR, 6, 3, 3> Base;
+
+    Eigen::Quaternion<EKF_SCALAR> _quat;    // Nominal attitude, body to world
+    Eigen::Vector<EKF_SCALAR, 3> _bias;     // Nominal gyro bias
+    EKF_SCALAR _q_attitude;                 // Gyro noise density, rad^2/s
+    EKF_SCALAR _q_bias;                     // Bias random walk, (rad/s)^2/s
+    EKF_SCALAR _r;                          // Variance of the normalized accelerometer
+    cGyroPreint _preint;                    // Batch of UpdateFifo()
+
+    // Attitude rows of F are full in the attitude block and diagonal in the bias block
+    struct PatternF {
+        static constexpr uint8_t at(uint32_t i, uint32_t j) {
+            if (i < 3) { return (j < 3 || j == i + 3) ? matrixf::kAny : matrixf::kZero; }
+            return i == j ? matrixf::kOne : matrixf::kZero;
+        }
+    };
+    // F of a preintegrated batch, the attitude rows are full
+    struct PatternFBatch {
+        static constexpr uint8_t at(uint32_t i, uint32_t j) {
+            return i < 3 ? matrixf::kAny : (i == j ? matrixf::kOne : matrixf::kZero);
+        }
+    };
+    // The accelerometer does not see the bias, the diagonal of [g]x is zero
+    struct PatternH {
+        static constexpr uint8_t at(uint32_t i, uint32_t j) {
+            return (j < 3 && i != j) ? matrixf::kAny : matrixf::kZero;
+        }
+    };
+
+    void InitState() {
+        _quat.setIdentity();
+        _bias.setZero();
+        _vecXhat.setZero();
+        _matFk.setIdentity();
+        _matPk.setZero();
+        for (uint32_t i = 0; i < 3; i++) {
+            _matPk(i, i) = 1.0f;        // rad^2, any initial tilt
+            _matPk(i + 3, i + 3) = 1e-4f;
+        }
+        _matRk = Eigen::Matrix<EKF_SCALAR, 3, 3>::Identity() * _r;
+    }
+
+public:
+    cESEKF(EKF_SCALAR process_noise_attitude,
+           EKF_SCALAR process_noise_bias,
+           EKF_SCALAR measure_noise_accelerometer) : Base(),
+                                                     _q_attitude(process_noise_attitude),
+                                                     _q_bias(process_noise_bias),
+                                                     _r(measure_noise_accelerometer) {
+        InitState();
+    }
+
+    void ResetEKF() {
+        Base::Reset();
+        InitState();
+        _preint.Clear();
+    }
+
+    /**
+     * Propagate with the gyro, then correct with the accelerometer if its norm
+     * is within 0.5 m/s^2 of gravity. Returns 0x01 if the correction was
+     * rejected, by the chi square gate of SetChi2Gate() or a singular S.
+     */
+    uint8_t
+    UpdateQuaternion(EKF_SCALAR accelx, EKF_SCALAR accely, EKF_SCALAR accelz, EKF_SCALAR gyrox, EKF_SCALAR gyroy,
+                     EKF_SCALAR gyroz, EKF_SCALAR dt) {
+        PredictGyro(gyrox, gyroy, gyroz, dt);
+        return CorrectAccel(accelx, accely, accelz);
+    }
+
+    // Step-1 and Step-2 alone, for gyro samples without an accelerometer sample
+    void PredictGyro(EKF_SCALAR gyrox, EKF_SCALAR gyroy, EKF_SCALAR gyroz, EKF_SCALAR dt) {
+        /*Step-1 predict the nominal state*/
+        _vecUk << gyrox - _bias(0), gyroy - _bias(1), gyroz - _bias(2);
+        Eigen::Vector<EKF_SCALAR, 3> half_angle = _vecUk * (0.5f * dt);
+        _quat = _quat * Eigen::Quaternion<EKF_SCALAR>(1.0f, half_angle(0), half_angle(1), half_angle(2));
+        _quat.normalize();
+
+        /*Step-2 predict P*/
+        // F = [[I - [ω·dt]x, -dt·I], [0, I]], the bias rows stay identity
+        EKF_SCALAR wx = _vecUk(0) * dt, wy = _vecUk(1) * dt, wz = _vecUk(2) * dt;
+        _matFk.topLeftCorner<3, 3>() << 1, wz, -wy,
+                -wz, 1, wx,
+                wy, -wx, 1;
+        _matFk.topRightCorner<3, 3>() = Eigen::Matrix<EKF_SCALAR, 3, 3>::Identity() * -dt;
+        _matPk = _matPk.congruence<6>(_matFk, PatternF());
+        for (uint32_t i = 0; i < 3; i++) {
+            _matPk(i, i) += _q_attitude * dt;
+            _matPk(i + 3, i + 3) += _q_bias * dt;
+        }
+    }
+
+    /**
+     * Step-1 and Step-2 over a whole batch of gyro samples, see cGyroPreint.
+     * Q is summed in closed form over the batch length T:
+     *      attitude σg²·T + σb²·T³/3,  attitude x bias -σb²·T²/2,  bias σb²·T
+     */
+    void PredictPreint(const cGyroPreint &preint) {
+        _quat = _quat * preint.Rotation().cast<EKF_SCALAR>();
+        _quat.normalize();
+        _matFk.topLeftCorner<3, 3>() = preint.Phi().cast<EKF_SCALAR>();
+        _matFk.topRightCorner<3, 3>() = preint.Gamma().cast<EKF_SCALAR>();
+        _matPk = _matPk.congruence<6>(_matFk, PatternFBatch());
+        EKF_SCALAR t = preint.Time();
+        for (uint32_t i = 0; i < 3; i++) {
+            _matPk(i, i) += _q_attitude * t + _q_bias * t * t * t * (1.0f / 3.0f);
+            _matPk(i, i + 3) -= _q_bias * t * t * 0.5f;
+            _matPk(i + 3, i + 3) += _q_bias * t;
+        }
+    }
+
+    /**
+     * One predict and one correction for a drained FIFO: count gyro samples
+     * gyro[3 * i + axis] at dt each, accel the newest accelerometer sample.
+     * Return as UpdateQuaternion().
+     */
+    uint8_t UpdateFifo(const float *gyro, uint32_t count, float dt, const float *accel) {
+        if (count == 0) {
+            return 0;
+        }
+        float bias[3];
+        GetGyroBias(bias);
+        _preint.Reset();
+        _preint.Integrate(gyro, count, dt, bias);
+        PredictPreint(_preint);
+        return CorrectAccel(accel[0], accel[1], accel[2]);
+    }
+
+    // Step-3 and Step-4 alone, return as UpdateQuaternion()
+    uint8_t CorrectAccel(EKF_SCALAR accelx, EKF_SCALAR accely, EKF_SCALAR accelz) {
+        /*Step-3 correct with gravity*/
+        EKF_SCALAR accel_norm = sqrt(accelx * accelx + accely * accely + accelz * accelz);
+        if (fabs(accel_norm - 9.8f) > 0.5f) {
+            return 0;
+        }
+        EKF_SCALAR norm_inverse = 1.0f / accel_norm;
+        Eigen::Vector<EKF_SCALAR, 3> z(accelx * norm_inverse, accely * norm_inverse, accelz * norm_inverse);
+        // g = RT·[0,0,1], the last row of R
+        Eigen::Vector<EKF_SCALAR, 3> g;
+        g << 2.0f * (_quat.x() * _quat.z() - _quat.w() * _quat.y()),
+                2.0f * (_quat.w() * _quat.x() + _quat.y() * _quat.z()),
+                _quat.w() * _quat.w() - _quat.x() * _quat.x() - _quat.y() * _quat.y() + _quat.z() * _quat.z();
+        _matHk.setZero();
+        _matHk.leftCols<3>() << 0, -g(2), g(1),
+                g(2), 0, -g(0),
+                -g(1), g(0), 0;
+        uint8_t status = Correct(z, z - g, PatternH());
+        if (status) {
+            return status;
+        }
+
+        /*Step-4 inject the error and reset it*/
+        _quat = _quat * Eigen::Quaternion<EKF_SCALAR>(1.0f, 0.5f * _vecXhat(0), 0.5f * _vecXhat(1),
+                                                      0.5f * _vecXhat(2));
+        _quat.normalize();
+        _bias += _vecXhat.tail<3>();
+        _vecXhat.setZero();
+        return 0;
+    }
+
+    void GetQuaternion(float *qbuf) const {
+        qbuf[0] = _quat.w();
+        qbuf[1] = _quat.x();
+        qbuf[2] = _quat.y();
+        qbuf[3] = _quat.z();
+    }
+
+    void GetGyroBias(float *bias) const {
+        bias[0] = _bias(0);
+        bias[1] = _bias(1);
+        bias[2] = _bias(2);
+    }
+
+    const Eigen::Quaternion<EKF_SCALAR> &Quaternion() const { return _quat; }
+};
+}  // namespace EKF
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * @Description: Gyro preintegration of FIFO batches for the AHRS filters
+ * @Author: qianwan
+ * @Date: 2026-10-17 10:00:00
+ * @LastEditTime: 2026-10-17 10:00:00
+ * @LastEditors: qianwan
+ */
+/**
+ * EKF::cGyroPreint preint;
+ * // FIFO drained, gyro[3 * i + axis] in rad/s, dt of one sample
+ * preint.Integrate(gyro, count, dt, bias);
+ * ahrs.PredictPreint(preint);
+ * preint.Reset();
+ *
+ * A whole batch of gyro samples becomes one rotation and one Jacobian, so
+ * the filter predicts P once per batch instead of once per sample.
+ *
+ * Every sample adds the rotation vector a(k) = (gyro - bias)·dt with the
+ * coning term of the previous sample, da(k) = a(k) + a(k-1) x a(k) / 12,
+ * which recovers the rotation the sampled rate misses when the axis turns
+ * within the batch. The error of the end attitude against the start is
+ *      dθ(end) = ΔRT·dθ(start) - ΔRT·Σ R(k)·dt(k)·db
+ * where R(k) is the rotation from the start to sample k, so only Σ R(k)·dt(k)
+ * is summed per sample. Gyro noise is isotropic and sums to σg²·T whatever
+ * the rotation, the bias walk terms use the same closed form for any T.
+ */
+#pragma once
+#ifndef LIB_KALMAN_IMUPREINT_
+#define LIB_KALMAN_IMUPREINT_
+
+#include <cstdint>
+
+#include "../Eigen/Dense"
+#include "../Eigen/Geometry"
+
+namespace EKF {
+
+class cGyroPreint {
+protected:
+    Eigen::Quaternion<float> _dq;                   // Rotation from the start of the batch
+    Eigen::Matrix<float, 3, 3> _sum_rot;            // Σ R(k)·dt(k)
+    Eigen::Vector<float, 3> _alpha_prev;            // Rotation vector of the previous sample, for coning
+    float _time;                                    // Length of the batch, s
+    uint32_t _count;
+
+public:
+    cGyroPreint() { Clear(); }
+
+    // Start a new batch, the last sample is kept for the coning term
+    void Reset() {
+        _dq.setIdentity();
+        _sum_rot.setZero();
+        _time = 0.0f;
+        _count = 0;
+    }
+
+    // Reset() and forget the last sample, after a gap in the data
+    void Clear() {
+        Reset();
+        _alpha_prev.setZero();
+    }
+
+    void Add(float gyrox, float gyroy, float gyroz, float dt, const float *bias) {
+        Eigen::Vector<float, 3> alpha((gyrox - bias[0]) * dt, (gyroy - bias[1]) * dt, (gyroz - bias[2]) * dt);
+        Eigen::Vector<float, 3> theta = alpha + _alpha_prev.cross(alpha) * (1.0f / 12.0f);
+        _alpha_prev = alpha;
+        // exp(θ) to third order, well below float rounding for |θ| < 0.05
+        float n2 = theta.squaredNorm();
+        float s = 0.5f - n2 * (1.0f / 48.0f);
+        _dq = _dq * Eigen::Quaternion<float>(1.0f - n2 * 0.125f, theta(0) * s, theta(1) * s, theta(2) * s);
+        _sum_rot.noalias() += _dq.toRotationMatrix() * dt;
+        _time += dt;
+        _count++;
+    }
+
+    // count samples at one dt, gyro[3 * i + axis] in rad/s, bias as the filter has it now
+    void Integrate(const float *gyro, uint32_t count, float dt, const float *bias) {
+        for (uint32_t i = 0; i < count; i++, gyro += 3) { Add(gyro[0], gyro[1], gyro[2], dt, bias); }
+        _dq.normalize();
+    }
+
+    // Rotation over the batch, body at the start to body at the end
+    Eigen::Quaternion<float> Rotation() const { return _dq.normalized(); }
+
+    // dθ(end) = Phi·dθ(start) + Gamma·db
+    Eigen::Matrix<float, 3, 3> Phi() const { return Rotation().toRotationMatrix().transpose(); }
+
+    Eigen::Matrix<float, 3, 3> Gamma() const { return -Phi() * _sum_rot; }
+
+    float Time() const { return _time; }
+
+    uint32_t Count() const { return _count; }
+};
+}  // namespace EKF
+
+#endif
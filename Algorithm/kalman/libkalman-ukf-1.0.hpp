@@ -0,0 +1,265 @@
+/*
+ * @Description: Unscented kalman filter on the base of cKalmanA
+ * @Author: qianwan
+ * @Date: 2026-10-17 10:00:00
+ * @LastEditTime: 2026-10-17 10:00:00
+ * @LastEditors: qianwan
+ */
+/**
+ * KalmanA::cUKF<float, 4, 2, 2> ukf;
+ * ukf.SetProcessNoise(Q);
+ * ukf.SetMeasureNoise(R);
+ * // One sigma point per call, f(x, u, dt) and h(x) return Eigen vectors
+ * ukf.Predict([](const auto &x, const auto &u, float dt) { ... }, u, dt);
+ * ukf.Update([](const auto &x) { ... }, z);
+ * // Or all sigma points per call, in place on the SoA matrix
+ * ukf.PredictSoA([](auto &X, const auto &u, float dt) { X.row(0) += X.row(2) * dt; ... }, u, dt);
+ * ukf.UpdateSoA([](const auto &X, auto &Z) { Z.row(0) = (X.row(0).array().square() + ...).sqrt(); }, z);
+ *
+ * Scaled unscented transform with 2·Xsize+1 sigma points, additive Q and R.
+ * Sigma points are stored as structure of arrays, row i holds component i of
+ * every point, so the means, the covariances and models written on whole
+ * rows (the SoA calls) run as vector instructions across the points.
+ * P stays packed and S is factorized once like cKalmanA::Correct(), P is
+ * updated in Joseph form, see Correct().
+ *
+ * Scaling (SetScaling()): alpha 1, beta 2, kappa 0 by default, so every
+ * weight is positive apart from the covariance weight of the centre; small
+ * alpha gives large negative centre weights which float does not take well.
+ */
+#pragma once
+#ifndef LIB_KALMAN_UKF_
+#define LIB_KALMAN_UKF_
+
+#include <cmath>
+
+#include "libkalman-1.0.hpp"
+
+namespace KalmanA {
+
+template<typename Scalar, uint32_t Xsize, uint32_t Usize, uint32_t Zsize>
+class cUKF : public cKalmanA<Scalar, Xsize, Usize, Zsize> {
+public:
+    static constexpr uint32_t kSigma = 2 * Xsize + 1;
+    // Pivots of P below kFloor·P(i,i) are rounding, some times the float epsilon
+    static constexpr Scalar kFloor = Scalar(1e-6);
+
+    // Sigma points, row i is component i of every point
+    typedef Eigen::Matrix<Scalar, Xsize, kSigma, Eigen::RowMajor> SigmaX;
+    typedef Eigen::Matrix<Scalar, Zsize, kSigma, Eigen::RowMajor> SigmaZ;
+
+protected:
+    typedef cKalmanA<Scalar, Xsize, Usize, Zsize> Base;
+    using Base::_vecXhat;
+    using Base::_vecUk;
+    using Base::_vecZk;
+    using Base::_matPk;
+    using Base::_matK;
+    using Base::_matQk;
+    using Base::_matRk;
+    using Base::_chi2;
+    using Base::_chi2_gate;
+
+    SigmaX _sigma_x;
+    SigmaZ _sigma_z;
+    Eigen::Matrix<Scalar, 1, kSigma> _wm;   // Weights of the mean
+    Eigen::Matrix<Scalar, 1, kSigma> _wc;   // Weights of the covariance
+    Scalar _gamma;                          // Spread, sqrt(Xsize + lambda)
+    Scalar _l[Xsize][Xsize];                // P = L·LT of the last sigma points
+    Scalar _l_inv[Xsize];
+
+    /**
+     * Sigma points of x and P, 0x01 if P is not positive semidefinite. P that
+     * spans more than float resolves, e.g. a position known to 1e-9 next to a
+     * velocity at 1e-2, is only semidefinite after rounding, the directions
+     * below kFloor get no spread (see Cholesky()).
+     */
+    uint8_t Sigma() {
+        if (Base::Cholesky(_matPk, _l, _l_inv, kFloor)) { return 0x01; }
+        for (uint32_t i = 0; i < Xsize; i++) {
+            Scalar x = _vecXhat(i);
+            _sigma_x(i, 0) = x;
+            for (uint32_t j = 0; j < Xsize; j++) {
+                Scalar d = j <= i ? _gamma * _l[i][j] : Scalar(0);
+                _sigma_x(i, 1 + j) = x + d;
+                _sigma_x(i, 1 + Xsize + j) = x - d;
+            }
+        }
+        return 0;
+    }
+
+    // x = Σ wm·X, P = Σ wc·(X-x)·(X-x)T + Q
+    void Recombine() {
+        _vecXhat.noalias() = _sigma_x * _wm.transpose();
+        SigmaX dev = _sigma_x.colwise() - _vecXhat;
+        SigmaX dev_w = dev.array().rowwise() * _wc.array();
+        for (uint32_t i = 0; i < Xsize; i++) {
+            for (uint32_t j = i; j < Xsize; j++) { _matPk(i, j) = dev_w.row(i).dot(dev.row(j)); }
+        }
+        _matPk.addDense(_matQk);
+    }
+
+    // Z holds h of the sigma points of x, P
+    uint8_t Correct(const Eigen::Vector<Scalar, Zsize> &z) {
+        _vecZk = z;
+        Eigen::Vector<Scalar, Zsize> zhat = _sigma_z * _wm.transpose();
+        SigmaZ dev_z = _sigma_z.colwise() - zhat;
+        SigmaZ dev_zw = dev_z.array().rowwise() * _wc.array();
+        // S = Σ wc·dZ·dZT + R
+        matrixf::SymMatrix<Scalar, Zsize> sym_s;
+        for (uint32_t i = 0; i < Zsize; i++) {
+            for (uint32_t j = i; j < Zsize; j++) { sym_s(i, j) = dev_zw.row(i).dot(dev_z.row(j)); }
+        }
+        sym_s.addDense(_matRk);
+        /*
+         * The points are x ± γ·L(:,j), so Pxz = Σ wc·dX·dZT = L·MT with
+         * M = γ·wc·(Z+ - Z-), M is also H·L for H = PxzT·P^-1, the linear part
+         * of h the sigma points see.
+         */
+        Eigen::Matrix<Scalar, Zsize, Xsize> mat_m = (_sigma_z.template middleCols<Xsize>(1) -
+                                                     _sigma_z.template rightCols<Xsize>()) * (_gamma * _wc(1));
+        Eigen::Matrix<Scalar, Xsize, Zsize> mat_pxz;
+        for (uint32_t r = 0; r < Xsize; r++) {
+            for (uint32_t i = 0; i < Zsize; i++) {
+                Scalar acc = 0;
+                for (uint32_t k = 0; k <= r; k++) { acc += _l[r][k] * mat_m(i, k); }
+                mat_pxz(r, i) = acc;
+            }
+        }
+        Scalar l[Zsize][Zsize];
+        Scalar l_inv[Zsize];
+        if (Base::Cholesky(sym_s, l, l_inv)) { return 0x01; }
+        // y = L^-1·v, ChiSquare = |y|^2
+        Eigen::Vector<Scalar, Zsize> v = z - zhat;
+        Eigen::Vector<Scalar, Zsize> y;
+        for (uint32_t i = 0; i < Zsize; i++) {
+            Scalar acc = v(i);
+            for (uint32_t k = 0; k < i; k++) { acc -= l[i][k] * y(k); }
+            y(i) = acc * l_inv[i];
+        }
+        _chi2 = y.squaredNorm();
+        if (_chi2_gate > 0 && _chi2 > _chi2_gate) { return 0x01; }
+        // K = Pxz·S^-1 row by row through L
+        for (uint32_t r = 0; r < Xsize; r++) {
+            Scalar w[Zsize];
+            for (uint32_t i = 0; i < Zsize; i++) {
+                Scalar acc = mat_pxz(r, i);
+                for (uint32_t k = 0; k < i; k++) { acc -= l[i][k] * w[k]; }
+                w[i] = acc * l_inv[i];
+            }
+            for (uint32_t i = Zsize; i-- > 0;) {
+                Scalar acc = w[i];
+                for (uint32_t k = i + 1; k < Zsize; k++) { acc -= l[k][i] * _matK(r, k); }
+                _matK(r, i) = acc * l_inv[i];
+            }
+        }
+        /*
+         * P - K·S·KT cancels to rounding noise along well measured directions and
+         * soon stops being positive in float. The same P in Joseph form is a sum
+         * of squares, with E = dZ - H·dX what h has beyond its linear part:
+         *      P` = (I-K·H)·P·(I-K·H)T + K·R'·KT = G·GT
+         *      G = [L - K·M, K·C],  R' = R + Σ wc·E·ET = C·CT
+         * H·dX is 0 at the centre and ±γ·M(:,j) at the points.
+         */
+        for (uint32_t j = 0; j < Xsize; j++) {
+            dev_z.col(1 + j).noalias() -= _gamma * mat_m.col(j);
+            dev_z.col(1 + Xsize + j).noalias() += _gamma * mat_m.col(j);
+        }
+        dev_zw = dev_z.array().rowwise() * _wc.array();
+        matrixf::SymMatrix<Scalar, Zsize> sym_r;
+        for (uint32_t i = 0; i < Zsize; i++) {
+            for (uint32_t j = i; j < Zsize; j++) { sym_r(i, j) = dev_zw.row(i).dot(dev_z.row(j)); }
+        }
+        sym_r.addDense(_matRk);
+        Scalar c[Zsize][Zsize];
+        if (Base::Cholesky(sym_r, c, l_inv, kFloor)) { return 0x01; }
+        // Every failure exit is behind, x and P change together from here
+        _vecXhat.noalias() += _matK * v;
+        Eigen::Matrix<Scalar, Xsize, Xsize> mat_km = _matK * mat_m;
+        Eigen::Matrix<Scalar, Xsize, Xsize + Zsize> mat_g;
+        for (uint32_t i = 0; i < Xsize; i++) {
+            for (uint32_t j = 0; j < Xsize; j++) { mat_g(i, j) = (j <= i ? _l[i][j] : Scalar(0)) - mat_km(i, j); }
+            for (uint32_t j = 0; j < Zsize; j++) {
+                Scalar acc = 0;
+                for (uint32_t k = j; k < Zsize; k++) { acc += _matK(i, k) * c[k][j]; }
+                mat_g(i, Xsize + j) = acc;
+            }
+        }
+        _matPk.setZero();
+        _matPk.template rankUpdate<Xsize + Zsize>(mat_g, Scalar(1));
+        return 0;
+    }
+
+public:
+    cUKF() : Base() { SetScaling(1, 2, 0); }
+
+    /**
+     * lambda = alpha^2·(Xsize + kappa) - Xsize, the points sit at
+     * x ± sqrt(Xsize + lambda)·L, beta adds to the centre weight of P
+     * (2 for Gaussian x).
+     */
+    void SetScaling(Scalar alpha, Scalar beta, Scalar kappa) {
+        Scalar n = Scalar(Xsize);
+        Scalar lambda = alpha * alpha * (n + kappa) - n;
+        _gamma = std::sqrt(n + lambda);
+        _wm.setConstant(Scalar(0.5) / (n + lambda));
+        _wc.setConstant(Scalar(0.5) / (n + lambda));
+        _wm(0) = lambda / (n + lambda);
+        _wc(0) = _wm(0) + 1 - alpha * alpha + beta;
+    }
+
+    /**
+     * x = f(x, u, dt) through the sigma points, P from their spread plus Q.
+     * f takes const Eigen::Vector<Scalar, Xsize>& and returns one, it runs once
+     * per sigma point. Returns 0x01 if P is not positive definite, nothing is
+     * changed then.
+     */
+    template<typename Func>
+    uint8_t Predict(Func &&f, const Eigen::Vector<Scalar, Usize> &u, Scalar dt) {
+        _vecUk = u;
+        if (Sigma()) { return 0x01; }
+        for (uint32_t k = 0; k < kSigma; k++) {
+            Eigen::Vector<Scalar, Xsize> x = _sigma_x.col(k);
+            _sigma_x.col(k) = f(x, _vecUk, dt);
+        }
+        Recombine();
+        return 0;
+    }
+
+    // As above, f(SigmaX &X, u, dt) moves every sigma point in place in one call
+    template<typename Func>
+    uint8_t PredictSoA(Func &&f, const Eigen::Vector<Scalar, Usize> &u, Scalar dt) {
+        _vecUk = u;
+        if (Sigma()) { return 0x01; }
+        f(_sigma_x, _vecUk, dt);
+        Recombine();
+        return 0;
+    }
+
+    /**
+     * Correct with z, h(x) the expected measurement, through new sigma points
+     * of x and P. h takes const Eigen::Vector<Scalar, Xsize>& and returns
+     * Eigen::Vector<Scalar, Zsize>. Returns 0x01 if P or S is not positive
+     * definite or the chi square is above SetChi2Gate(), x and P are unchanged then.
+     */
+    template<typename Func>
+    uint8_t Update(Func &&h, const Eigen::Vector<Scalar, Zsize> &z) {
+        if (Sigma()) { return 0x01; }
+        for (uint32_t k = 0; k < kSigma; k++) {
+            Eigen::Vector<Scalar, Xsize> x = _sigma_x.col(k);
+            _sigma_z.col(k) = h(x);
+        }
+        return Correct(z);
+    }
+
+    // As above, h(const SigmaX &X, SigmaZ &Z) fills the measurement of every sigma point in one call
+    template<typename Func>
+    uint8_t UpdateSoA(Func &&h, const Eigen::Vector<Scalar, Zsize> &z) {
+        if (Sigma()) { return 0x01; }
+        h(static_cast<const SigmaX &>(_sigma_x), _sigma_z);
+        return Correct(z);
+    }
+};
+}  // namespace KalmanA
+
+#endif
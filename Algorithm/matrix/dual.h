@@ -0,0 +1,255 @@
+/**
+ ******************************************************************************
+ * @file    dual.h
+ * @brief   Dual numbers for forward mode automatic differentiation.
+ *          A model written once over a scalar T gives its value with
+ *          T = float and its value and Jacobian with T = Dual<float, N>.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Usage:
+ *      // y = h(x), generic over the scalar
+ *      auto h = [](const auto *x, auto *y) { y[0] = x[0] * x[1]; y[1] = sin(x[0]); };
+ *      Matrixf<2, 2> H;
+ *      float y[2];
+ *      jacobian<2, 2>(h, x, y, H);          // one pass, y = h(x), H = dh/dx
+ *
+ * Dual<T, N> carries a value and its N partial derivatives, every operation
+ * applies the chain rule, so one evaluation of h costs about N + 1 times
+ * the float one with no truncation error, against N + 1 evaluations and
+ * a step size trade-off for finite differences. Call the math functions
+ * unqualified (sin(x), not std::sin(x)) so they resolve for both float and
+ * Dual. Matrixf stores float only, so the model works on arrays or Eigen
+ * matrices of Dual (see KalmanA in libkalman-1.0.hpp) and the Jacobian is
+ * returned as Matrixf.
+ */
+
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "matrix.h"
+
+namespace matrixf {
+
+    template<typename T, uint32_t N>
+    class Dual {
+    public:
+        using Scalar = T;
+
+        T v;        // Value
+        T d[N];     // Partial derivatives
+
+        constexpr Dual() : v(), d{} {}
+
+        // Constant, zero derivatives
+        constexpr Dual(T value) : v(value), d{} {}  // NOLINT(google-explicit-constructor)
+
+        // Independent variable i of N
+        constexpr Dual(T value, uint32_t i) : v(value), d{} { d[i] = T(1); }
+
+        MATRIX_INLINE constexpr Dual &operator+=(const Dual &b) {
+            v += b.v;
+            small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { d[i] += b.d[i]; });
+            return *this;
+        }
+
+        MATRIX_INLINE constexpr Dual &operator-=(const Dual &b) {
+            v -= b.v;
+            small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { d[i] -= b.d[i]; });
+            return *this;
+        }
+
+        MATRIX_INLINE constexpr Dual &operator*=(const Dual &b) {
+            small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { d[i] = d[i] * b.v + v * b.d[i]; });
+            v *= b.v;
+            return *this;
+        }
+
+        MATRIX_INLINE constexpr Dual &operator/=(const Dual &b) {
+            T inv = T(1) / b.v;
+            v *= inv;
+            small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { d[i] = (d[i] - v * b.d[i]) * inv; });
+            return *this;
+        }
+
+        MATRIX_INLINE constexpr Dual operator-() const {
+            Dual res;
+            res.v = -v;
+            small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { res.d[i] = -d[i]; });
+            return res;
+        }
+
+        MATRIX_INLINE constexpr Dual operator+() const { return *this; }
+
+        // Value and derivatives of f(v) from f(v) and f'(v)
+        MATRIX_INLINE constexpr Dual chain(T f, T df) const {
+            Dual res;
+            res.v = f;
+            small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { res.d[i] = df * d[i]; });
+            return res;
+        }
+    };
+
+// Not deduced, so scalar operands of any arithmetic type convert to constants
+    template<typename T, uint32_t N>
+    using DualScalar = typename Dual<T, N>::Scalar;
+
+/* Arithmetic */
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator+(Dual<T, N> a, const Dual<T, N> &b) { return a += b; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator+(Dual<T, N> a, const DualScalar<T, N> &b) { return a += Dual<T, N>(b); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator+(const DualScalar<T, N> &a, Dual<T, N> b) { return b += Dual<T, N>(a); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator-(Dual<T, N> a, const Dual<T, N> &b) { return a -= b; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator-(Dual<T, N> a, const DualScalar<T, N> &b) { return a -= Dual<T, N>(b); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator-(const DualScalar<T, N> &a, const Dual<T, N> &b) {
+        return Dual<T, N>(a) -= b;
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator*(Dual<T, N> a, const Dual<T, N> &b) { return a *= b; }
+
+    // Scaling by a constant skips the product rule
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator*(Dual<T, N> a, const DualScalar<T, N> &b) {
+        a.v *= b;
+        small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { a.d[i] *= b; });
+        return a;
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator*(const DualScalar<T, N> &a, const Dual<T, N> &b) { return b * a; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator/(Dual<T, N> a, const Dual<T, N> &b) { return a /= b; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator/(const Dual<T, N> &a, const DualScalar<T, N> &b) {
+        return a * (T(1) / b);
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr Dual<T, N> operator/(const DualScalar<T, N> &a, const Dual<T, N> &b) {
+        return Dual<T, N>(a) /= b;
+    }
+
+/* Comparisons look at the value */
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr bool operator<(const Dual<T, N> &a, const Dual<T, N> &b) { return a.v < b.v; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr bool operator>(const Dual<T, N> &a, const Dual<T, N> &b) { return a.v > b.v; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr bool operator<=(const Dual<T, N> &a, const Dual<T, N> &b) { return a.v <= b.v; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr bool operator>=(const Dual<T, N> &a, const Dual<T, N> &b) { return a.v >= b.v; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr bool operator==(const Dual<T, N> &a, const Dual<T, N> &b) { return a.v == b.v; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE constexpr bool operator!=(const Dual<T, N> &a, const Dual<T, N> &b) { return a.v != b.v; }
+
+/* Math functions, found by argument dependent lookup */
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> sqrt(const Dual<T, N> &a) {
+        T s = std::sqrt(a.v);
+        return a.chain(s, T(0.5) / s);
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> sin(const Dual<T, N> &a) { return a.chain(std::sin(a.v), std::cos(a.v)); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> cos(const Dual<T, N> &a) { return a.chain(std::cos(a.v), -std::sin(a.v)); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> tan(const Dual<T, N> &a) {
+        T t = std::tan(a.v);
+        return a.chain(t, T(1) + t * t);
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> asin(const Dual<T, N> &a) {
+        return a.chain(std::asin(a.v), T(1) / std::sqrt(T(1) - a.v * a.v));
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> acos(const Dual<T, N> &a) {
+        return a.chain(std::acos(a.v), T(-1) / std::sqrt(T(1) - a.v * a.v));
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> atan(const Dual<T, N> &a) { return a.chain(std::atan(a.v), T(1) / (T(1) + a.v * a.v)); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> atan2(const Dual<T, N> &y, const Dual<T, N> &x) {
+        Dual<T, N> res;
+        res.v = std::atan2(y.v, x.v);
+        T inv = T(1) / (x.v * x.v + y.v * y.v);
+        small::unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { res.d[i] = (x.v * y.d[i] - y.v * x.d[i]) * inv; });
+        return res;
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> exp(const Dual<T, N> &a) {
+        T e = std::exp(a.v);
+        return a.chain(e, e);
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> log(const Dual<T, N> &a) { return a.chain(std::log(a.v), T(1) / a.v); }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> pow(const Dual<T, N> &a, T p) {
+        T f = std::pow(a.v, p - T(1));
+        return a.chain(f * a.v, p * f);
+    }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> abs(const Dual<T, N> &a) { return a.v < T(0) ? -a : a; }
+
+    template<typename T, uint32_t N>
+    MATRIX_INLINE Dual<T, N> fabs(const Dual<T, N> &a) { return abs(a); }
+
+/**
+ * y = f(x) and J = df/dx in one pass, f(const T *x, T *y) generic over T.
+ * x has _n elements, y has _m, y may be nullptr.
+ */
+    template<uint32_t _m, uint32_t _n, typename F>
+    MATRIX_INLINE void jacobian(F &&f, const float *x, float *y, Matrixf<_m, _n> &J) {
+        using D = Dual<float, _n>;
+        D xd[_n];
+        D yd[_m];
+        // Unrolled, so the duals stay in registers instead of arrays indexed at run time
+        small::unroll<_n>([&](auto j) MATRIX_LAMBDA_INLINE { xd[j] = D(x[j], j); });
+        f(static_cast<const D *>(xd), static_cast<D *>(yd));
+        small::unroll<_m>([&](auto i) MATRIX_LAMBDA_INLINE {
+            if (y != nullptr) { y[i] = yd[i].v; }
+            small::unroll<_n>([&](auto j) MATRIX_LAMBDA_INLINE { J(i, j) = yd[i].d[j]; });
+        });
+    }
+
+}  // namespace matrixf
+
+#endif  // DUAL_H
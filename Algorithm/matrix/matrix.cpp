@@ -23,14 +23,17 @@
 #include "matrix.h"
 
 // hat of vector
-matrixf::Matrixf<3, 3> vector3f::hat(matrixf::Matrixf<3, 1> vec) {
+matrixf::Matrixf<3, 3> vector3f::hat(const matrixf::Matrixf<3, 1> &vec) {
         float hat[9] = {0, -vec(2, 0), vec(1, 0),
                         vec(2, 0), 0, -vec(0, 0),
                         -vec(1, 0), vec(0, 0), 0};
         return {hat};
     }
 
-// cross product
+// cross product, written out instead of hat(vec1) * vec2
 matrixf::Matrixf<3, 1> vector3f::cross(const matrixf::Matrixf<3, 1> &vec1, const matrixf::Matrixf<3, 1> &vec2) {
-        return vector3f::hat(vec1) * vec2;
+        float res[3] = {vec1(1, 0) * vec2(2, 0) - vec1(2, 0) * vec2(1, 0),
+                        vec1(2, 0) * vec2(0, 0) - vec1(0, 0) * vec2(2, 0),
+                        vec1(0, 0) * vec2(1, 0) - vec1(1, 0) * vec2(0, 0)};
+        return {res};
     }
@@ -2,7 +2,8 @@
  ******************************************************************************
  * @file    matrix.cpp/h
  * @brief   A matrix calculate lib.
- *          Use last arm_math lib to get better performance
+ *          Use last arm_math lib to get better performance on Cortex-M,
+ *          SIMD or plain kernels elsewhere, see matrix_backend.h
  ******************************************************************************
  * Original code (C)
  * @author  Spoon Guan
@@ -15,14 +16,64 @@
  * @note    Modified operators
  * @date    2023/11/11
  * @author  qianwan.Jin
- * @version 1.0
+ * @version 1.9
  * @stepper 0.0
+ * ******************************************************************************
+ * @note    Portable compute backend
+ * @date    2026/10/17
+ * @version 1.1
+ * ******************************************************************************
+ * @note    Lazy expression templates, see matrix_expr.h
+ * @date    2026/10/17
+ * @version 1.2
+ * ******************************************************************************
+ * @note    Unrolled kernels up to 6x6, see matrix_small.h
+ * @date    2026/10/17
+ * @version 1.3
+ * ******************************************************************************
+ * @note    LU, Cholesky, LDL^T and QR solvers, see matrix_decomp.h
+ * @date    2026/10/17
+ * @version 1.4
+ * ******************************************************************************
+ * @note    Storage is the bare array, block/row/col/diagonal views, see matrix_view.h
+ * @date    2026/10/17
+ * @version 1.5
+ * ******************************************************************************
+ * @note    In-place multiply, transpose and solve on a caller's Scratch
+ * @date    2026/10/17
+ * @version 1.6
+ * ******************************************************************************
+ * @note    constexpr construction, expressions and Zeros/Ones/Eye/Diag
+ * @date    2026/10/17
+ * @version 1.7
+ * ******************************************************************************
+ * @note    Closed-form 3x3 symmetric eigensolver and Jacobi SVD, see matrix_eig.h
+ * @date    2026/10/17
+ * @version 1.8
+ * ******************************************************************************
+ * @note    Matrix exponential and c2d discretization, see matrix_expm.h
+ * @date    2026/10/17
+ * @version 1.9
  * *****************************************************************************
  */
 
 /**
+ * In-place updates in a fast loop can keep their temporaries in a Scratch
+ * owned by the caller instead of the stack:
+ *      static matrixf::Scratch<36> scratch;
+ *      P.leftMult(F, scratch);                 // P = F*P
+ *      P.assign(P * F.transpose(), scratch);   // any expression
+ * The size is checked at compile time, the operations never fail on it.
+ *
+ * Constant model matrices can be built by the compiler and stay in flash:
+ *      constexpr Matrixf<4, 4> F = Eye<4, 4>() + A * dt;
+ * Expressions, factories and small kernels are constexpr, the backend
+ * kernels of large sizes are not.
+ *
  * Arm matrix storage as mat(i,j)=mat_data[i*cols+j]
  * [a11,a12,a13,a21,a22,a23,a31,a32,a33]
+ * sizeof(Matrixf) is the data only, aligned to the SIMD width when it holds
+ * a full vector, so arrays of matrices and raw copies stay cheap.
  */
 
 
@@ -30,35 +81,78 @@
 #define MATRIX_H
 
 #include <cstdint>
+#include <cstring>
 
-#include "arm_math.h"
+#include "matrix_backend.h"
+#include "matrix_expr.h"
+#include "matrix_view.h"
 
 namespace matrixf {
+    template<uint32_t _n>
+    class LU;
+
+    template<uint32_t _n>
+    class Cholesky;
+
+    template<uint32_t _n>
+    class LDLT;
+
+    template<uint32_t _rows, uint32_t _cols>
+    class QR;
+
+    class SymEig3;
+
+    template<uint32_t _rows, uint32_t _cols>
+    class SVD;
+
+// Caller owned temporary storage of _size floats, see the note above
+    template<uint32_t _size>
+    class Scratch {
+    protected:
+        alignas(backend::kAlign<_size>) float data_[_size];
+
+    public:
+        static constexpr uint32_t kSize = _size;
+
+        float *data() { return data_; }
+    };
+
 // Matrix class
     template<uint32_t _rows, uint32_t _cols>
-    class Matrixf {
+    class Matrixf : public MatrixExpr<Matrixf<_rows, _cols>> {
     protected:
         // data
-        float data_[_rows * _cols];
+        alignas(backend::kAlign<_rows * _cols>) float data_[_rows * _cols];
 
-    public:
-        // arm matrix instance
-        arm_matrix_instance_f32 arm_mat_;
+        static constexpr uint32_t min_size_ = _rows < _cols ? _rows : _cols;
 
-        // Constructor without input data
-        Matrixf() {
-            arm_mat_.numCols = _cols;
-            arm_mat_.numRows = _rows;
-            arm_mat_.pData = data_;
+        // Evaluate an expression, through a temporary if it reads this matrix
+        template<typename E>
+        constexpr void assign(const E &e) {
+            static_assert(E::kRows == _rows && E::kCols == _cols, "Matrix size mismatch");
+            assignTo(data_, _cols, e);
         }
 
-        Matrixf(const float* data) : Matrixf() {
-            memcpy(this->data_, data, _rows * _cols * sizeof(float));
+    public:
+        static constexpr uint32_t kRows = _rows;
+        static constexpr uint32_t kCols = _cols;
+        static constexpr bool kDirect = true;
+
+        // Constructor without input data, Matrixf<r, c> m{} is zeros
+        Matrixf() = default;
+
+        constexpr Matrixf(const float* data) : data_{} {
+            for (uint32_t i = 0; i < _rows * _cols; i++) { data_[i] = data[i]; }
         }
 
         // Copy constructor
-        Matrixf(const Matrixf<_rows, _cols> &mat) : Matrixf() {
-            memcpy(this->data_, mat.data_, _rows * _cols * sizeof(float));
+        Matrixf(const Matrixf<_rows, _cols> &mat) = default;
+
+        // Evaluate an expression
+        template<typename E>
+        constexpr Matrixf(const MatrixExpr<E> &e) : data_{} {
+            static_assert(E::kRows == _rows && E::kCols == _cols, "Matrix size mismatch");
+            e.derived().evalTo(data_);
         }
 
         // Destructor
@@ -66,33 +160,73 @@ namespace matrixf {
 
         /*  Operators about elements    */
         // Row size
-        uint32_t rows() { return _rows; }
+        constexpr uint32_t rows() const { return _rows; }
 
         // Column size
-        uint32_t cols() { return _cols; }
+        constexpr uint32_t cols() const { return _cols; }
 
         // Column size
-        uint32_t size() { return _rows * _cols; }
+        constexpr uint32_t size() const { return _rows * _cols; }
+
+        // Raw data in row-major order
+        constexpr float *data() { return data_; }
+
+        constexpr const float *data() const { return data_; }
 
         // Overload the function call operator for element access
-        float &operator()(const uint32_t &row, const uint32_t &col) {
+        constexpr float &operator()(const uint32_t &row, const uint32_t &col) {
             return data_[row * _cols + col];
         }
 
-        // Overload the function call operator for getting specific row vector
-        Matrixf<1, _cols> row(const uint32_t &row) {
-            Matrixf<1, _cols> res;
-            memcpy(&res(0, 0), data_ + row * _cols, _cols * sizeof(float));
-            return res;
+        constexpr const float &operator()(const uint32_t &row, const uint32_t &col) const {
+            return data_[row * _cols + col];
         }
 
-        // Overload the function call operator for getting specific col vector
-        Matrixf<_rows, 1> col(const uint32_t &col) {
-            Matrixf<_rows, 1> res;
-            for (uint32_t i = 0; i < _rows; i++) {
-                res(i, 0) = data_[i * _cols + col];
-            }
-            return res;
+        // Element access of expression nodes
+        MATRIX_INLINE constexpr float coeff(uint32_t row, uint32_t col) const { return data_[row * _cols + col]; }
+
+        bool overlaps(const ExprDst &d) const { return d.overlaps(data_, data_ + _rows * _cols); }
+
+        bool aliases(const ExprDst &d) const { return d.aliases(data_, data_ + _rows * _cols, _cols); }
+
+        // View of the rows x cols block at (row, col)
+        template<uint32_t rows, uint32_t cols>
+        MatrixView<rows, cols, _cols, float> block(const uint32_t &row, const uint32_t &col) {
+            static_assert(rows <= _rows && cols <= _cols, "Block out of range");
+            return MatrixView<rows, cols, _cols, float>(data_ + row * _cols + col);
+        }
+
+        template<uint32_t rows, uint32_t cols>
+        MatrixView<rows, cols, _cols, const float> block(const uint32_t &row, const uint32_t &col) const {
+            static_assert(rows <= _rows && cols <= _cols, "Block out of range");
+            return MatrixView<rows, cols, _cols, const float>(data_ + row * _cols + col);
+        }
+
+        // View of a specific row vector
+        MatrixView<1, _cols, _cols, float> row(const uint32_t &row) {
+            return MatrixView<1, _cols, _cols, float>(data_ + row * _cols);
+        }
+
+        MatrixView<1, _cols, _cols, const float> row(const uint32_t &row) const {
+            return MatrixView<1, _cols, _cols, const float>(data_ + row * _cols);
+        }
+
+        // View of a specific col vector
+        MatrixView<_rows, 1, _cols, float> col(const uint32_t &col) {
+            return MatrixView<_rows, 1, _cols, float>(data_ + col);
+        }
+
+        MatrixView<_rows, 1, _cols, const float> col(const uint32_t &col) const {
+            return MatrixView<_rows, 1, _cols, const float>(data_ + col);
+        }
+
+        // View of the diagonal as a column vector
+        MatrixView<min_size_, 1, _cols + 1, float> diagonal() {
+            return MatrixView<min_size_, 1, _cols + 1, float>(data_);
+        }
+
+        MatrixView<min_size_, 1, _cols + 1, const float> diagonal() const {
+            return MatrixView<min_size_, 1, _cols + 1, const float>(data_);
         }
 
 //        // Overload the << operator for matrix assignment
@@ -122,147 +256,254 @@ namespace matrixf {
         }
 
         /*Operators about operations*/
-        Matrixf<_rows, _cols> &operator=(const Matrixf<_rows, _cols> mat) {
-            memcpy(this->data_, mat.data_, _rows * _cols * sizeof(float));
+        Matrixf<_rows, _cols> &operator=(const Matrixf<_rows, _cols> &mat) = default;
+
+        template<typename E>
+        constexpr Matrixf<_rows, _cols> &operator=(const MatrixExpr<E> &e) {
+            assign(e.derived());
             return *this;
         }
 
-        Matrixf<_rows, _cols> &operator+=(const Matrixf<_rows, _cols> mat) {
-            arm_mat_add_f32(&this->arm_mat_, &mat.arm_mat_, &this->arm_mat_);
+        constexpr Matrixf<_rows, _cols> &operator+=(const Matrixf<_rows, _cols> &mat) {
+            if constexpr (small::kEnable<_rows, _cols>) {
+                small::add<_rows * _cols>(data_, mat.data_, data_);
+            } else {
+                backend::add(data_, mat.data_, data_, _rows * _cols);
+            }
             return *this;
         }
 
-        Matrixf<_rows, _cols> &operator-=(const Matrixf<_rows, _cols> mat) {
-            arm_mat_sub_f32(&this->arm_mat_, &mat.arm_mat_, &this->arm_mat_);
+        template<typename E>
+        constexpr Matrixf<_rows, _cols> &operator+=(const MatrixExpr<E> &e) {
+            assign(*this + e.derived());
             return *this;
         }
 
-        Matrixf<_rows, _cols> &operator*=(const float &val) {
-            arm_mat_scale_f32(&this->arm_mat_, val, &this->arm_mat_);
+        constexpr Matrixf<_rows, _cols> &operator-=(const Matrixf<_rows, _cols> &mat) {
+            if constexpr (small::kEnable<_rows, _cols>) {
+                small::sub<_rows * _cols>(data_, mat.data_, data_);
+            } else {
+                backend::sub(data_, mat.data_, data_, _rows * _cols);
+            }
             return *this;
         }
 
-        Matrixf<_rows, _cols> &operator*=(const Matrixf<_rows, _cols> &mat) {
-            arm_mat_mult_f32(&this->arm_mat_, &mat.arm_mat_, &this->arm_mat_);
+        template<typename E>
+        constexpr Matrixf<_rows, _cols> &operator-=(const MatrixExpr<E> &e) {
+            assign(*this - e.derived());
             return *this;
         }
 
-        Matrixf<_rows, _cols> &operator/=(const float &val) {
-            arm_mat_scale_f32(&this->arm_mat_, 1.f / val, &this->arm_mat_);
+        constexpr Matrixf<_rows, _cols> &operator*=(const float &val) {
+            if constexpr (small::kEnable<_rows, _cols>) {
+                small::scale<_rows * _cols>(data_, val, data_);
+            } else {
+                backend::scale(data_, val, data_, _rows * _cols);
+            }
             return *this;
         }
 
-        Matrixf<_rows, _cols> operator+(const Matrixf<_rows, _cols> &mat) {
-            Matrixf<_rows, _cols> res;
-            arm_mat_add_f32(&this->arm_mat_, &mat.arm_mat_, &res.arm_mat_);
-            return res;
+        // Result of a product is written through a temporary, see assign()
+        template<typename E>
+        constexpr Matrixf<_rows, _cols> &operator*=(const MatrixExpr<E> &e) {
+            assign(*this * e.derived());
+            return *this;
         }
 
-        Matrixf<_rows, _cols> operator-(const Matrixf<_rows, _cols> &mat) {
-            Matrixf<_rows, _cols> res;
-            arm_mat_sub_f32(&this->arm_mat_, &mat.arm_mat_, &res.arm_mat_);
-            return res;
+        constexpr Matrixf<_rows, _cols> &operator/=(const float &val) {
+            return *this *= 1.f / val;
         }
 
-        Matrixf<_rows, _cols> operator*(const float &val) {
-            Matrixf<_rows, _cols> res;
-            arm_mat_scale_f32(&this->arm_mat_, val, &res.arm_mat_);
-            return res;
+        /*In-place operations with the temporary in a Scratch*/
+        // this = e, e is evaluated into the scratch first only if it reads this matrix
+        template<typename E, uint32_t _size>
+        Matrixf<_rows, _cols> &assign(const MatrixExpr<E> &e, Scratch<_size> &scratch) {
+            static_assert(E::kRows == _rows && E::kCols == _cols, "Matrix size mismatch");
+            static_assert(_size >= _rows * _cols, "Scratch too small");
+            const ExprDst d = {data_, data_ + _rows * _cols, _cols};
+            if (e.derived().aliases(d)) {
+                e.derived().evalTo(scratch.data());
+                memcpy(data_, scratch.data(), sizeof(data_));
+            } else {
+                e.derived().evalTo(data_);
+            }
+            return *this;
         }
 
-        friend Matrixf<_rows, _cols> operator*(const float &val,
-                                               const Matrixf<_rows, _cols> &mat) {
-            Matrixf<_rows, _cols> res;
-            arm_mat_scale_f32(&mat.arm_mat_, val, &res.arm_mat_);
-            return res;
+        // this = this * mat
+        template<uint32_t _size>
+        Matrixf<_rows, _cols> &mult(const Matrixf<_cols, _cols> &mat, Scratch<_size> &scratch) {
+            return assign(*this * mat, scratch);
         }
 
-        Matrixf<_rows, _cols> operator/(const float &val) {
-            Matrixf<_rows, _cols> res;
-            arm_mat_scale_f32(&this->arm_mat_, 1.f / val, &res.arm_mat_);
-            return res;
+        // this = mat * this
+        template<uint32_t _size>
+        Matrixf<_rows, _cols> &leftMult(const Matrixf<_rows, _rows> &mat, Scratch<_size> &scratch) {
+            return assign(mat * *this, scratch);
         }
 
-        // Matrix multiplication
-        template<uint32_t cols>
-        friend Matrixf<_rows, cols> operator*(const Matrixf<_rows, _cols> &mat1,
-                                              const Matrixf<_cols, cols> &mat2) {
-            Matrixf<_rows, cols> res;
-            arm_mat_mult_f32(&mat1.arm_mat_, &mat2.arm_mat_, &res.arm_mat_);
-            return res;
+        // this = this^T by swapping across the diagonal, no temporary
+        Matrixf<_rows, _cols> &transposeInPlace() {
+            static_assert(_rows == _cols, "Only square matrix transposes in place");
+            for (uint32_t i = 0; i < _rows; i++) {
+                for (uint32_t j = i + 1; j < _cols; j++) {
+                    float t = data_[i * _cols + j];
+                    data_[i * _cols + j] = data_[j * _cols + i];
+                    data_[j * _cols + i] = t;
+                }
+            }
+            return *this;
+        }
+
+        /**
+         * b = this^-1 * b by Gauss elimination with partial pivoting, b may be
+         * this matrix. The scratch holds copies of both, so b is only written
+         * on success. Return 0 on success, 0x01 if this matrix is singular.
+         */
+        template<uint32_t _bcols, uint32_t _size>
+        uint8_t solveInPlace(Matrixf<_rows, _bcols> &b, Scratch<_size> &scratch) const {
+            static_assert(_rows == _cols, "Only square matrix solves");
+            static_assert(_size >= _rows * (_cols + _bcols), "Scratch too small");
+            float *a = scratch.data();
+            float *x = a + _rows * _cols;
+            memcpy(a, data_, sizeof(data_));
+            memcpy(x, b.data(), _rows * _bcols * sizeof(float));
+            for (uint32_t c = 0; c < _rows; c++) {
+                uint32_t pivot = c;
+                float pmax = a[c * _cols + c] < 0 ? -a[c * _cols + c] : a[c * _cols + c];
+                for (uint32_t r = c + 1; r < _rows; r++) {
+                    float v = a[r * _cols + c] < 0 ? -a[r * _cols + c] : a[r * _cols + c];
+                    if (v > pmax) {
+                        pmax = v;
+                        pivot = r;
+                    }
+                }
+                if (pmax == 0.0f) { return 0x01; }
+                if (pivot != c) {
+                    for (uint32_t k = c; k < _cols; k++) {
+                        float t = a[c * _cols + k];
+                        a[c * _cols + k] = a[pivot * _cols + k];
+                        a[pivot * _cols + k] = t;
+                    }
+                    for (uint32_t k = 0; k < _bcols; k++) {
+                        float t = x[c * _bcols + k];
+                        x[c * _bcols + k] = x[pivot * _bcols + k];
+                        x[pivot * _bcols + k] = t;
+                    }
+                }
+                float inv = 1.0f / a[c * _cols + c];
+                for (uint32_t r = c + 1; r < _rows; r++) {
+                    float f = a[r * _cols + c] * inv;
+                    for (uint32_t k = c + 1; k < _cols; k++) { a[r * _cols + k] -= f * a[c * _cols + k]; }
+                    for (uint32_t k = 0; k < _bcols; k++) { x[r * _bcols + k] -= f * x[c * _bcols + k]; }
+                }
+            }
+            // Back substitution
+            for (uint32_t r = _rows; r-- > 0;) {
+                float inv = 1.0f / a[r * _cols + r];
+                for (uint32_t k = 0; k < _bcols; k++) {
+                    float acc = x[r * _bcols + k];
+                    for (uint32_t j = r + 1; j < _cols; j++) { acc -= a[r * _cols + j] * x[j * _bcols + k]; }
+                    x[r * _bcols + k] = acc * inv;
+                }
+            }
+            memcpy(b.data(), x, _rows * _bcols * sizeof(float));
+            return 0;
         }
 
         // Transpose
-        Matrixf<_cols, _rows> transpose() {
-            Matrixf<_cols, _rows> res;
-            arm_mat_trans_f32(&arm_mat_, &res.arm_mat_);
-            return res;
+        constexpr TransposeExpr<Matrixf<_rows, _cols>> transpose() const {
+            return TransposeExpr<Matrixf<_rows, _cols>>(*this);
         }
 
         // Trace
-        float trace() {
+        constexpr float trace() const {
             float res = 0;
-            for (uint32_t i = 0; i < fmin(_rows, _cols); i++) {
+            for (uint32_t i = 0; i < min_size_; i++) {
                 res += (*this)(i, i);
             }
             return res;
         }
 
-        // Inverse
-        Matrixf<_cols, _rows> inverse() {
-            Matrixf<_cols, _rows> res(*this);
-            arm_mat_inverse_f32(res, res);
+        // Factorizations, prefer solve() of these to inverse()
+        LU<_rows> lu() const;
+
+        Cholesky<_rows> cholesky() const;
+
+        LDLT<_rows> ldlt() const;
+
+        QR<_rows, _cols> qr() const;
+
+        // Eigen decomposition of a symmetric 3x3, singular value decomposition
+        SymEig3 symEig() const;
+
+        SVD<_rows, _cols> svd() const;
+
+        // Matrix exponential e^A, see matrix_expm.h
+        Matrixf<_rows, _cols> expm() const;
+
+        // Inverse, a singular matrix gives zeros
+        Matrixf<_cols, _rows> inverse() const {
+            static_assert(_rows == _cols, "Only square matrix has inverse");
+            Matrixf<_rows, _cols> tmp(*this);
+            Matrixf<_cols, _rows> res;
+            uint8_t err;
+            if constexpr (small::kEnable<_rows, _cols>) {
+                err = small::inverse<_rows>(tmp.data_, res.data_);
+            } else {
+                err = backend::inverse(tmp.data_, res.data_, _rows);
+            }
+            if (err != 0) {
+                memset(res.data_, 0, sizeof(res.data_));
+            }
             return res;
         }
 
         // Norm Frobenius-Norm
-        float norm() { return _sqrtf((this->transpose() * *this)(0, 0)); }
+        float norm() const { return backend::sqrt(backend::dot(data_, data_, _rows * _cols)); }
 
         // normalized
-        Matrixf<_cols, _rows> normalized() {
-            Matrixf<_cols, _rows> res;
-            arm_mat_scale_f32(&arm_mat_, 1.0f / this->norm(), &res);
-            return res;
+        Matrixf<_rows, _cols> normalized() const {
+            return *this * (1.0f / this->norm());
         }
     };
 
 
 
 /* Matrix functions*/
-// Special Matrices
+// Special Matrices, constexpr so constant model matrices are built at compile time
 // Zero matrix
     template<uint32_t _rows, uint32_t _cols>
-    Matrixf<_rows, _cols> Zeros() {
-        float data[_rows * _cols] = {0};
-        return Matrixf<_rows, _cols>(data);
+    constexpr Matrixf<_rows, _cols> Zeros() {
+        return Matrixf<_rows, _cols>{};
     }
 
 // Ones matrix
     template<uint32_t _rows, uint32_t _cols>
-    Matrixf<_rows, _cols> Ones() {
-        float data[_rows * _cols] = {0};
+    constexpr Matrixf<_rows, _cols> Ones() {
+        Matrixf<_rows, _cols> res{};
         for (uint32_t i = 0; i < _rows * _cols; i++) {
-            data[i] = 1;
+            res.data()[i] = 1;
         }
-        return Matrixf<_rows, _cols>(data);
+        return res;
     }
 
 // Identity matrix
     template<uint32_t _rows, uint32_t _cols>
-    Matrixf<_rows, _cols> Eye() {
-        float data[_rows * _cols] = {0};
-        for (uint32_t i = 0; i < fmin(_rows, _cols); i++) {
-            data[i * _cols + i] = 1;
+    constexpr Matrixf<_rows, _cols> Eye() {
+        Matrixf<_rows, _cols> res{};
+        for (uint32_t i = 0; i < _rows && i < _cols; i++) {
+            res(i, i) = 1;
         }
-        return Matrixf<_rows, _cols>(data);
+        return res;
     }
 
 // Diagonal matrix
     template<uint32_t _rows, uint32_t _cols>
-    Matrixf<_rows, _cols> Diag(Matrixf<_rows, 1> vec) {
-        Matrixf<_rows, _cols> res = matrixf::Zeros<_rows, _cols>();
-        for (uint32_t i = 0; i < fmin(_rows, _cols); i++) {
-            res[i][i] = vec[i][0];
+    constexpr Matrixf<_rows, _cols> Diag(const Matrixf<_rows, 1> &vec) {
+        Matrixf<_rows, _cols> res{};
+        for (uint32_t i = 0; i < _rows && i < _cols; i++) {
+            res(i, i) = vec(i, 0);
         }
         return res;
     }
@@ -271,10 +512,14 @@ namespace matrixf {
 
 namespace vector3f {
 // hat of vector
-    matrixf::Matrixf<3, 3> hat(matrixf::Matrixf<3, 1> vec);
+    matrixf::Matrixf<3, 3> hat(const matrixf::Matrixf<3, 1> &vec);
 
-// cross product
+// cross product, see quaternion.h for rotations
     matrixf::Matrixf<3, 1> cross(const matrixf::Matrixf<3, 1> &vec1, const matrixf::Matrixf<3, 1> &vec2);
 }  // namespace vector3f
 
+#include "matrix_decomp.h"
+#include "matrix_eig.h"
+#include "matrix_expm.h"
+
 #endif  // MATRIX_H
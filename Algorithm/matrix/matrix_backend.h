@@ -0,0 +1,352 @@
+/**
+ ******************************************************************************
+ * @file    matrix_backend.h
+ * @brief   Compile-time selected compute backend of matrix.h.
+ *          CMSIS-DSP on Cortex-M, AVX2/SSE or NEON kernels on hosts and
+ *          application cores, plain loops everywhere else.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Select a backend by defining MATRIX_BACKEND to one of the ids below before
+ * including matrix.h, otherwise it is detected from the compiler target:
+ *      Cortex-M             -> MATRIX_BACKEND_CMSIS
+ *      x86 with AVX2 + FMA  -> MATRIX_BACKEND_AVX2
+ *      x86 with SSE2        -> MATRIX_BACKEND_SSE
+ *      ARM with NEON        -> MATRIX_BACKEND_NEON
+ *      others               -> MATRIX_BACKEND_SCALAR
+ * All kernels use row-major storage, mat(i,j)=mat_data[i*cols+j].
+ */
+
+#ifndef MATRIX_BACKEND_H
+#define MATRIX_BACKEND_H
+
+#include <cmath>
+#include <cstdint>
+
+#define MATRIX_BACKEND_SCALAR 0
+#define MATRIX_BACKEND_CMSIS  1
+#define MATRIX_BACKEND_SSE    2
+#define MATRIX_BACKEND_AVX2   3
+#define MATRIX_BACKEND_NEON   4
+
+#ifndef MATRIX_BACKEND
+#if defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M')
+#define MATRIX_BACKEND MATRIX_BACKEND_CMSIS
+#elif defined(__AVX2__) && defined(__FMA__)
+#define MATRIX_BACKEND MATRIX_BACKEND_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#define MATRIX_BACKEND MATRIX_BACKEND_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MATRIX_BACKEND MATRIX_BACKEND_NEON
+#else
+#define MATRIX_BACKEND MATRIX_BACKEND_SCALAR
+#endif
+#endif
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+#include "arm_math.h"
+#elif MATRIX_BACKEND == MATRIX_BACKEND_AVX2
+#include <immintrin.h>
+#elif MATRIX_BACKEND == MATRIX_BACKEND_SSE
+#include <emmintrin.h>
+#elif MATRIX_BACKEND == MATRIX_BACKEND_NEON
+#include <arm_neon.h>
+#endif
+
+namespace matrixf {
+namespace backend {
+
+/*Lane description of each vector instruction set*/
+    struct SimdScalar {
+        using reg = float;
+        static constexpr uint32_t width = 1;
+
+        static inline reg load(const float *p) { return *p; }
+
+        static inline void store(float *p, reg v) { *p = v; }
+
+        static inline reg set1(float v) { return v; }
+
+        static inline reg add(reg a, reg b) { return a + b; }
+
+        static inline reg sub(reg a, reg b) { return a - b; }
+
+        static inline reg mul(reg a, reg b) { return a * b; }
+
+        // a + b * c
+        static inline reg fmadd(reg a, reg b, reg c) { return a + b * c; }
+
+        static inline float hsum(reg v) { return v; }
+    };
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_AVX2
+    struct SimdNative {
+        using reg = __m256;
+        static constexpr uint32_t width = 8;
+
+        static inline reg load(const float *p) { return _mm256_loadu_ps(p); }
+
+        static inline void store(float *p, reg v) { _mm256_storeu_ps(p, v); }
+
+        static inline reg set1(float v) { return _mm256_set1_ps(v); }
+
+        static inline reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+
+        static inline reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+
+        static inline reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+
+        static inline reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(b, c, a); }
+
+        static inline float hsum(reg v) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+            return _mm_cvtss_f32(s);
+        }
+    };
+#elif MATRIX_BACKEND == MATRIX_BACKEND_SSE
+    struct SimdNative {
+        using reg = __m128;
+        static constexpr uint32_t width = 4;
+
+        static inline reg load(const float *p) { return _mm_loadu_ps(p); }
+
+        static inline void store(float *p, reg v) { _mm_storeu_ps(p, v); }
+
+        static inline reg set1(float v) { return _mm_set1_ps(v); }
+
+        static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+
+        static inline reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+
+        static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+
+        static inline reg fmadd(reg a, reg b, reg c) { return _mm_add_ps(a, _mm_mul_ps(b, c)); }
+
+        static inline float hsum(reg v) {
+            __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+            return _mm_cvtss_f32(s);
+        }
+    };
+#elif MATRIX_BACKEND == MATRIX_BACKEND_NEON
+    struct SimdNative {
+        using reg = float32x4_t;
+        static constexpr uint32_t width = 4;
+
+        static inline reg load(const float *p) { return vld1q_f32(p); }
+
+        static inline void store(float *p, reg v) { vst1q_f32(p, v); }
+
+        static inline reg set1(float v) { return vdupq_n_f32(v); }
+
+        static inline reg add(reg a, reg b) { return vaddq_f32(a, b); }
+
+        static inline reg sub(reg a, reg b) { return vsubq_f32(a, b); }
+
+        static inline reg mul(reg a, reg b) { return vmulq_f32(a, b); }
+
+        static inline reg fmadd(reg a, reg b, reg c) { return vmlaq_f32(a, b, c); }
+
+        static inline float hsum(reg v) {
+            float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+            return vget_lane_f32(vpadd_f32(s, s), 0);
+        }
+    };
+#else
+    using SimdNative = SimdScalar;
+#endif
+
+    // Alignment of a buffer of n floats, up to a full vector but never adding padding
+    constexpr uint32_t alignOf(uint32_t n, uint32_t lanes = SimdNative::width) {
+        return (lanes == 1 || n % lanes == 0) ? lanes * sizeof(float) : alignOf(n, lanes / 2);
+    }
+
+    template<uint32_t _n>
+    constexpr uint32_t kAlign = alignOf(_n);
+
+/*Generic kernels, instantiated for one lane description*/
+    template<typename V>
+    struct Kernel {
+        // dst = a + b
+        static inline void add(const float *a, const float *b, float *dst, uint32_t n) {
+            uint32_t i = 0;
+            for (; i + V::width <= n; i += V::width) {
+                V::store(dst + i, V::add(V::load(a + i), V::load(b + i)));
+            }
+            for (; i < n; i++) { dst[i] = a[i] + b[i]; }
+        }
+
+        // dst = a - b
+        static inline void sub(const float *a, const float *b, float *dst, uint32_t n) {
+            uint32_t i = 0;
+            for (; i + V::width <= n; i += V::width) {
+                V::store(dst + i, V::sub(V::load(a + i), V::load(b + i)));
+            }
+            for (; i < n; i++) { dst[i] = a[i] - b[i]; }
+        }
+
+        // dst = a * k
+        static inline void scale(const float *a, float k, float *dst, uint32_t n) {
+            uint32_t i = 0;
+            typename V::reg vk = V::set1(k);
+            for (; i + V::width <= n; i += V::width) {
+                V::store(dst + i, V::mul(V::load(a + i), vk));
+            }
+            for (; i < n; i++) { dst[i] = a[i] * k; }
+        }
+
+        // sum(a .* b)
+        static inline float dot(const float *a, const float *b, uint32_t n) {
+            uint32_t i = 0;
+            typename V::reg acc = V::set1(0.0f);
+            for (; i + V::width <= n; i += V::width) {
+                acc = V::fmadd(acc, V::load(a + i), V::load(b + i));
+            }
+            float res = V::hsum(acc);
+            for (; i < n; i++) { res += a[i] * b[i]; }
+            return res;
+        }
+
+        // dst(m*p) = a(m*n) * b(n*p), ikj order so the inner loop streams rows of b
+        static inline void mult(const float *a, const float *b, float *dst, uint32_t m, uint32_t n, uint32_t p) {
+            for (uint32_t i = 0; i < m; i++) {
+                float *drow = dst + i * p;
+                const float *arow = a + i * n;
+                uint32_t j = 0;
+                for (; j + V::width <= p; j += V::width) {
+                    typename V::reg acc = V::set1(0.0f);
+                    for (uint32_t k = 0; k < n; k++) {
+                        acc = V::fmadd(acc, V::set1(arow[k]), V::load(b + k * p + j));
+                    }
+                    V::store(drow + j, acc);
+                }
+                for (; j < p; j++) {
+                    float acc = 0.0f;
+                    for (uint32_t k = 0; k < n; k++) { acc += arow[k] * b[k * p + j]; }
+                    drow[j] = acc;
+                }
+            }
+        }
+    };
+
+/*Backend entry points used by Matrixf*/
+
+    inline void add(const float *a, const float *b, float *dst, uint32_t n) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        arm_add_f32(a, b, dst, n);
+#else
+        Kernel<SimdNative>::add(a, b, dst, n);
+#endif
+    }
+
+    inline void sub(const float *a, const float *b, float *dst, uint32_t n) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        arm_sub_f32(a, b, dst, n);
+#else
+        Kernel<SimdNative>::sub(a, b, dst, n);
+#endif
+    }
+
+    inline void scale(const float *a, float k, float *dst, uint32_t n) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        arm_scale_f32(a, k, dst, n);
+#else
+        Kernel<SimdNative>::scale(a, k, dst, n);
+#endif
+    }
+
+    inline float dot(const float *a, const float *b, uint32_t n) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        float res;
+        arm_dot_prod_f32(a, b, n, &res);
+        return res;
+#else
+        return Kernel<SimdNative>::dot(a, b, n);
+#endif
+    }
+
+    inline float sqrt(float x) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        float res;
+        arm_sqrt_f32(x, &res);
+        return res;
+#else
+        return std::sqrt(x);
+#endif
+    }
+
+    // dst must not overlap a or b
+    inline void mult(const float *a, const float *b, float *dst, uint32_t m, uint32_t n, uint32_t p) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        arm_matrix_instance_f32 ma = {(uint16_t) m, (uint16_t) n, (float *) a};
+        arm_matrix_instance_f32 mb = {(uint16_t) n, (uint16_t) p, (float *) b};
+        arm_matrix_instance_f32 md = {(uint16_t) m, (uint16_t) p, dst};
+        arm_mat_mult_f32(&ma, &mb, &md);
+#else
+        Kernel<SimdNative>::mult(a, b, dst, m, n, p);
+#endif
+    }
+
+    /**
+     * dst(n*n) = a(n*n)^-1, a is destroyed.
+     * Return 0 on success, 0x01 if a is singular.
+     */
+    inline uint8_t inverse(float *a, float *dst, uint32_t n) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        arm_matrix_instance_f32 ma = {(uint16_t) n, (uint16_t) n, a};
+        arm_matrix_instance_f32 md = {(uint16_t) n, (uint16_t) n, dst};
+        return arm_mat_inverse_f32(&ma, &md) == ARM_MATH_SUCCESS ? 0 : 0x01;
+#else
+        // Gauss-Jordan with partial pivoting
+        for (uint32_t i = 0; i < n * n; i++) { dst[i] = 0.0f; }
+        for (uint32_t i = 0; i < n; i++) { dst[i * n + i] = 1.0f; }
+
+        for (uint32_t c = 0; c < n; c++) {
+            uint32_t pivot = c;
+            float pmax = std::fabs(a[c * n + c]);
+            for (uint32_t r = c + 1; r < n; r++) {
+                float v = std::fabs(a[r * n + c]);
+                if (v > pmax) {
+                    pmax = v;
+                    pivot = r;
+                }
+            }
+            if (pmax == 0.0f) { return 0x01; }
+            if (pivot != c) {
+                for (uint32_t k = 0; k < n; k++) {
+                    float t = a[c * n + k];
+                    a[c * n + k] = a[pivot * n + k];
+                    a[pivot * n + k] = t;
+                    t = dst[c * n + k];
+                    dst[c * n + k] = dst[pivot * n + k];
+                    dst[pivot * n + k] = t;
+                }
+            }
+            float inv = 1.0f / a[c * n + c];
+            Kernel<SimdNative>::scale(a + c * n, inv, a + c * n, n);
+            Kernel<SimdNative>::scale(dst + c * n, inv, dst + c * n, n);
+            for (uint32_t r = 0; r < n; r++) {
+                float f = a[r * n + c];
+                if (r == c || f == 0.0f) { continue; }
+                for (uint32_t k = 0; k < n; k++) {
+                    a[r * n + k] -= f * a[c * n + k];
+                    dst[r * n + k] -= f * dst[c * n + k];
+                }
+            }
+        }
+        return 0;
+#endif
+    }
+
+}  // namespace backend
+}  // namespace matrixf
+
+#endif  // MATRIX_BACKEND_H
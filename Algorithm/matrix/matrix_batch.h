@@ -0,0 +1,271 @@
+/**
+ ******************************************************************************
+ * @file    matrix_batch.h
+ * @brief   Many same-shaped small matrices in structure-of-arrays layout.
+ *          One vector instruction works on the same element of 4, 8 or 16
+ *          matrices, depending on the backend of matrix_backend.h.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Storage: element (i,j) of all matrices is contiguous,
+ *      batch(b,i,j)=batch_data[(i*cols+j)*count+b]
+ * Keep count a multiple of the SIMD width for full vectors, the remaining
+ * matrices are processed by scalar code. Loops over the inner dimension are
+ * unrolled, the batch is meant for small matrices.
+ */
+
+#ifndef MATRIX_BATCH_H
+#define MATRIX_BATCH_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "matrix.h"
+#include "matrix_backend.h"
+
+namespace matrixf {
+
+    template<uint32_t _rows, uint32_t _cols, uint32_t _count>
+    class MatrixBatch {
+    protected:
+        using V = backend::SimdNative;
+
+        alignas(backend::kAlign<_rows * _cols * _count>) float data_[_rows * _cols * _count];
+
+        // Run op(reg offset) over full vectors and op_tail(offset) on the rest
+        template<typename Op, typename OpTail>
+        static MATRIX_INLINE void lanes(Op op, OpTail op_tail) {
+            uint32_t b = 0;
+            for (; b + V::width <= _count; b += V::width) { op(b); }
+            for (; b < _count; b++) { op_tail(b); }
+        }
+
+    public:
+        static constexpr uint32_t kRows = _rows;
+        static constexpr uint32_t kCols = _cols;
+        static constexpr uint32_t kCount = _count;
+
+        MatrixBatch() = default;
+
+        uint32_t rows() const { return _rows; }
+
+        uint32_t cols() const { return _cols; }
+
+        // Number of matrices
+        uint32_t count() const { return _count; }
+
+        // Element (i,j) of matrix b
+        float &operator()(const uint32_t &b, const uint32_t &row, const uint32_t &col) {
+            return data_[(row * _cols + col) * _count + b];
+        }
+
+        const float &operator()(const uint32_t &b, const uint32_t &row, const uint32_t &col) const {
+            return data_[(row * _cols + col) * _count + b];
+        }
+
+        // Element (i,j) of all matrices
+        float *lane(const uint32_t &row, const uint32_t &col) { return data_ + (row * _cols + col) * _count; }
+
+        const float *lane(const uint32_t &row, const uint32_t &col) const {
+            return data_ + (row * _cols + col) * _count;
+        }
+
+        // Copy matrix b out
+        Matrixf<_rows, _cols> get(const uint32_t &b) const {
+            Matrixf<_rows, _cols> res;
+            for (uint32_t i = 0; i < _rows * _cols; i++) { res.data()[i] = data_[i * _count + b]; }
+            return res;
+        }
+
+        // Copy matrix b in
+        void set(const uint32_t &b, const Matrixf<_rows, _cols> &mat) {
+            for (uint32_t i = 0; i < _rows * _cols; i++) { data_[i * _count + b] = mat.data()[i]; }
+        }
+
+        // Copy the same matrix into all slots
+        void broadcast(const Matrixf<_rows, _cols> &mat) {
+            for (uint32_t i = 0; i < _rows * _cols; i++) {
+                for (uint32_t b = 0; b < _count; b++) { data_[i * _count + b] = mat.data()[i]; }
+            }
+        }
+
+        /*Operators about operations*/
+        MatrixBatch &operator+=(const MatrixBatch &mat) {
+            backend::add(data_, mat.data_, data_, _rows * _cols * _count);
+            return *this;
+        }
+
+        MatrixBatch &operator-=(const MatrixBatch &mat) {
+            backend::sub(data_, mat.data_, data_, _rows * _cols * _count);
+            return *this;
+        }
+
+        MatrixBatch &operator*=(const float &val) {
+            backend::scale(data_, val, data_, _rows * _cols * _count);
+            return *this;
+        }
+
+        MatrixBatch operator+(const MatrixBatch &mat) const {
+            MatrixBatch res;
+            backend::add(data_, mat.data_, res.data_, _rows * _cols * _count);
+            return res;
+        }
+
+        MatrixBatch operator-(const MatrixBatch &mat) const {
+            MatrixBatch res;
+            backend::sub(data_, mat.data_, res.data_, _rows * _cols * _count);
+            return res;
+        }
+
+        MatrixBatch operator*(const float &val) const {
+            MatrixBatch res;
+            backend::scale(data_, val, res.data_, _rows * _cols * _count);
+            return res;
+        }
+
+        // Matrix multiplication of each pair
+        template<uint32_t cols>
+        MatrixBatch<_rows, cols, _count> operator*(const MatrixBatch<_cols, cols, _count> &mat) const {
+            MatrixBatch<_rows, cols, _count> res;
+            lanes([&](uint32_t b) {
+                // Row i of each left matrix stays in registers while the right columns stream by
+                for (uint32_t i = 0; i < _rows; i++) {
+                    typename V::reg row[_cols];
+                    small::unroll<_cols>([&](auto k) MATRIX_LAMBDA_INLINE { row[k] = V::load(lane(i, k) + b); });
+                    for (uint32_t j = 0; j < cols; j++) {
+                        typename V::reg acc = V::set1(0.0f);
+                        small::unroll<_cols>([&](auto k) MATRIX_LAMBDA_INLINE {
+                            acc = V::fmadd(acc, row[k], V::load(mat.lane(k, j) + b));
+                        });
+                        V::store(res.lane(i, j) + b, acc);
+                    }
+                }
+            }, [&](uint32_t b) {
+                for (uint32_t i = 0; i < _rows; i++) {
+                    for (uint32_t j = 0; j < cols; j++) {
+                        float acc = 0.0f;
+                        for (uint32_t k = 0; k < _cols; k++) { acc += lane(i, k)[b] * mat.lane(k, j)[b]; }
+                        res.lane(i, j)[b] = acc;
+                    }
+                }
+            });
+            return res;
+        }
+
+        // Transpose of each matrix, whole lanes are moved
+        MatrixBatch<_cols, _rows, _count> transpose() const {
+            MatrixBatch<_cols, _rows, _count> res;
+            for (uint32_t i = 0; i < _rows; i++) {
+                for (uint32_t j = 0; j < _cols; j++) {
+                    memcpy(res.lane(j, i), lane(i, j), _count * sizeof(float));
+                }
+            }
+            return res;
+        }
+
+        /**
+         * Inverse of each matrix, branch free across the batch.
+         * Closed form up to 3x3, Gauss-Jordan without pivoting above, which
+         * needs non-zero leading minors as in positive definite covariances.
+         * Return 0 on success, 0x01 if any matrix is singular, the slot of a
+         * singular matrix is undefined.
+         */
+        uint8_t inverse(MatrixBatch<_rows, _cols, _count> &res) const {
+            static_assert(_rows == _cols, "Only square matrix has inverse");
+            uint8_t err = 0;
+            if constexpr (_rows == 1) {
+                for (uint32_t b = 0; b < _count; b++) {
+                    err |= (data_[b] == 0.0f);
+                    res.data_[b] = 1.0f / data_[b];
+                }
+            } else if constexpr (_rows == 2) {
+                // Closed form, the loops over the batch carry no branch and vectorize
+                const float *a00 = lane(0, 0), *a01 = lane(0, 1), *a10 = lane(1, 0), *a11 = lane(1, 1);
+                for (uint32_t b = 0; b < _count; b++) {
+                    float det = a00[b] * a11[b] - a01[b] * a10[b];
+                    err |= (det == 0.0f);
+                    float inv = 1.0f / det;
+                    res(b, 0, 0) = a11[b] * inv;
+                    res(b, 0, 1) = -a01[b] * inv;
+                    res(b, 1, 0) = -a10[b] * inv;
+                    res(b, 1, 1) = a00[b] * inv;
+                }
+            } else if constexpr (_rows == 3) {
+                for (uint32_t b = 0; b < _count; b++) {
+                    const MatrixBatch &m = *this;
+                    float c00 = m(b, 1, 1) * m(b, 2, 2) - m(b, 1, 2) * m(b, 2, 1);
+                    float c01 = m(b, 1, 2) * m(b, 2, 0) - m(b, 1, 0) * m(b, 2, 2);
+                    float c02 = m(b, 1, 0) * m(b, 2, 1) - m(b, 1, 1) * m(b, 2, 0);
+                    float det = m(b, 0, 0) * c00 + m(b, 0, 1) * c01 + m(b, 0, 2) * c02;
+                    err |= (det == 0.0f);
+                    float inv = 1.0f / det;
+                    res(b, 0, 0) = c00 * inv;
+                    res(b, 0, 1) = (m(b, 0, 2) * m(b, 2, 1) - m(b, 0, 1) * m(b, 2, 2)) * inv;
+                    res(b, 0, 2) = (m(b, 0, 1) * m(b, 1, 2) - m(b, 0, 2) * m(b, 1, 1)) * inv;
+                    res(b, 1, 0) = c01 * inv;
+                    res(b, 1, 1) = (m(b, 0, 0) * m(b, 2, 2) - m(b, 0, 2) * m(b, 2, 0)) * inv;
+                    res(b, 1, 2) = (m(b, 0, 2) * m(b, 1, 0) - m(b, 0, 0) * m(b, 1, 2)) * inv;
+                    res(b, 2, 0) = c02 * inv;
+                    res(b, 2, 1) = (m(b, 0, 1) * m(b, 2, 0) - m(b, 0, 0) * m(b, 2, 1)) * inv;
+                    res(b, 2, 2) = (m(b, 0, 0) * m(b, 1, 1) - m(b, 0, 1) * m(b, 1, 0)) * inv;
+                }
+            } else {
+                MatrixBatch a(*this);
+                for (uint32_t i = 0; i < _rows; i++) {
+                    for (uint32_t j = 0; j < _cols; j++) {
+                        float v = (i == j) ? 1.0f : 0.0f;
+                        for (uint32_t b = 0; b < _count; b++) { res(b, i, j) = v; }
+                    }
+                }
+                float f[_count];
+                for (uint32_t c = 0; c < _rows; c++) {
+                    // Scale row c by 1/pivot
+                    for (uint32_t b = 0; b < _count; b++) {
+                        err |= (a(b, c, c) == 0.0f);
+                        f[b] = 1.0f / a(b, c, c);
+                    }
+                    for (uint32_t k = 0; k < _cols; k++) {
+                        float *pa = a.lane(c, k), *pr = res.lane(c, k);
+                        lanes([&](uint32_t b) {
+                            V::store(pa + b, V::mul(V::load(pa + b), V::load(f + b)));
+                            V::store(pr + b, V::mul(V::load(pr + b), V::load(f + b)));
+                        }, [&](uint32_t b) {
+                            pa[b] *= f[b];
+                            pr[b] *= f[b];
+                        });
+                    }
+                    // Eliminate column c from the other rows
+                    for (uint32_t r = 0; r < _rows; r++) {
+                        if (r == c) { continue; }
+                        memcpy(f, a.lane(r, c), sizeof(f));
+                        for (uint32_t k = 0; k < _cols; k++) {
+                            float *ra = a.lane(r, k), *rr = res.lane(r, k);
+                            const float *pa = a.lane(c, k), *pr = res.lane(c, k);
+                            lanes([&](uint32_t b) {
+                                typename V::reg vf = V::load(f + b);
+                                V::store(ra + b, V::sub(V::load(ra + b), V::mul(vf, V::load(pa + b))));
+                                V::store(rr + b, V::sub(V::load(rr + b), V::mul(vf, V::load(pr + b))));
+                            }, [&](uint32_t b) {
+                                ra[b] -= f[b] * pa[b];
+                                rr[b] -= f[b] * pr[b];
+                            });
+                        }
+                    }
+                }
+            }
+            return err;
+        }
+
+        template<uint32_t, uint32_t, uint32_t>
+        friend class MatrixBatch;
+    };
+
+}  // namespace matrixf
+
+#endif  // MATRIX_BATCH_H
@@ -0,0 +1,249 @@
+/**
+ ******************************************************************************
+ * @file    matrix_bench.cpp
+ * @brief   Host benchmark of Matrixf against Eigen and plain loops.
+ *          Multiply, add, transpose, inverse and norm of every square size
+ *          from 1x1 to 12x12.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Build next to Eigen (../Eigen like the kalman filters) and run:
+ *      g++ -std=c++17 -O2 -march=native matrix_bench.cpp matrix.cpp -o matrix_bench
+ *      ./matrix_bench > bench_output.txt
+ *
+ * Output is CSV, one line per op, size and implementation:
+ *      op,n,impl,ns,gflops
+ * ns is the best of several runs per call, gflops counts 2n^3 for multiply
+ * and inverse, n^2 for add, 2n^2 for norm and 0 for transpose. Lines
+ * starting with # are comments, so the file can be diffed between commits.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <utility>
+
+#include "../Eigen/Dense"
+#include "matrix.h"
+
+namespace {
+
+    // Keep the compiler from dropping or hoisting work on p
+    template<typename T>
+    inline void escape(T *p) { asm volatile("" : : "g"(p) : "memory"); }
+
+    // Best time per call in ns over a few runs of at least 5 ms each
+    template<typename F>
+    double timeIt(F f) {
+        using clock = std::chrono::steady_clock;
+        uint32_t iters = 1;
+        while (true) {
+            auto t0 = clock::now();
+            for (uint32_t i = 0; i < iters; i++) { f(); }
+            double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+            if (ns > 5e6) { break; }
+            iters *= 2;
+        }
+        double best = 1e30;
+        for (uint32_t r = 0; r < 5; r++) {
+            auto t0 = clock::now();
+            for (uint32_t i = 0; i < iters; i++) { f(); }
+            double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / iters;
+            best = ns < best ? ns : best;
+        }
+        return best;
+    }
+
+    void report(const char *op, uint32_t n, const char *impl, double ns, double flops) {
+        printf("%s,%u,%s,%.2f,%.3f\n", op, (unsigned) n, impl, ns, flops / ns);
+    }
+
+/* Plain loops on row-major arrays */
+    template<uint32_t N>
+    void naiveMult(const float *a, const float *b, float *c) {
+        for (uint32_t i = 0; i < N; i++) {
+            for (uint32_t j = 0; j < N; j++) {
+                float acc = 0.0f;
+                for (uint32_t k = 0; k < N; k++) { acc += a[i * N + k] * b[k * N + j]; }
+                c[i * N + j] = acc;
+            }
+        }
+    }
+
+    template<uint32_t N>
+    void naiveAdd(const float *a, const float *b, float *c) {
+        for (uint32_t i = 0; i < N * N; i++) { c[i] = a[i] + b[i]; }
+    }
+
+    template<uint32_t N>
+    void naiveTrans(const float *a, float *c) {
+        for (uint32_t i = 0; i < N; i++) {
+            for (uint32_t j = 0; j < N; j++) { c[j * N + i] = a[i * N + j]; }
+        }
+    }
+
+    // Gauss-Jordan with partial pivoting
+    template<uint32_t N>
+    void naiveInverse(const float *in, float *c) {
+        float a[N * N];
+        for (uint32_t i = 0; i < N * N; i++) {
+            a[i] = in[i];
+            c[i] = (i % (N + 1) == 0) ? 1.0f : 0.0f;
+        }
+        for (uint32_t col = 0; col < N; col++) {
+            uint32_t p = col;
+            for (uint32_t r = col + 1; r < N; r++) {
+                if (std::fabs(a[r * N + col]) > std::fabs(a[p * N + col])) { p = r; }
+            }
+            for (uint32_t k = 0; k < N; k++) {
+                std::swap(a[col * N + k], a[p * N + k]);
+                std::swap(c[col * N + k], c[p * N + k]);
+            }
+            float inv = 1.0f / a[col * N + col];
+            for (uint32_t k = 0; k < N; k++) {
+                a[col * N + k] *= inv;
+                c[col * N + k] *= inv;
+            }
+            for (uint32_t r = 0; r < N; r++) {
+                if (r == col) { continue; }
+                float f = a[r * N + col];
+                for (uint32_t k = 0; k < N; k++) {
+                    a[r * N + k] -= f * a[col * N + k];
+                    c[r * N + k] -= f * c[col * N + k];
+                }
+            }
+        }
+    }
+
+    template<uint32_t N>
+    float naiveNorm(const float *a) {
+        float acc = 0.0f;
+        for (uint32_t i = 0; i < N * N; i++) { acc += a[i] * a[i]; }
+        return std::sqrt(acc);
+    }
+
+    template<uint32_t N>
+    void benchSize() {
+        const double n = N, mult_flops = 2 * n * n * n, add_flops = n * n, norm_flops = 2 * n * n;
+
+        // Diagonally dominant, so every inverse exists
+        matrixf::Matrixf<N, N> ma, mb, mc;
+        Eigen::Matrix<float, N, N, Eigen::RowMajor> ea, eb, ec;
+        float na[N * N], nb[N * N], nc[N * N];
+        for (uint32_t i = 0; i < N; i++) {
+            for (uint32_t j = 0; j < N; j++) {
+                float va = std::sin(0.3f + 0.37f * (float) (i * N + j)) + (i == j ? (float) N : 0.0f);
+                float vb = std::cos(0.7f + 0.21f * (float) (i * N + j)) + (i == j ? (float) N : 0.0f);
+                ma(i, j) = ea(i, j) = na[i * N + j] = va;
+                mb(i, j) = eb(i, j) = nb[i * N + j] = vb;
+            }
+        }
+        float s = 0.0f;
+
+        report("mult", N, "matrixf", timeIt([&] {
+            escape(&ma);
+            escape(&mb);
+            mc = ma * mb;
+            escape(&mc);
+        }), mult_flops);
+        report("mult", N, "eigen", timeIt([&] {
+            escape(&ea);
+            escape(&eb);
+            ec.noalias() = ea * eb;
+            escape(&ec);
+        }), mult_flops);
+        report("mult", N, "naive", timeIt([&] {
+            escape(na);
+            escape(nb);
+            naiveMult<N>(na, nb, nc);
+            escape(nc);
+        }), mult_flops);
+
+        report("add", N, "matrixf", timeIt([&] {
+            escape(&ma);
+            escape(&mb);
+            mc = ma + mb;
+            escape(&mc);
+        }), add_flops);
+        report("add", N, "eigen", timeIt([&] {
+            escape(&ea);
+            escape(&eb);
+            ec = ea + eb;
+            escape(&ec);
+        }), add_flops);
+        report("add", N, "naive", timeIt([&] {
+            escape(na);
+            escape(nb);
+            naiveAdd<N>(na, nb, nc);
+            escape(nc);
+        }), add_flops);
+
+        report("transpose", N, "matrixf", timeIt([&] {
+            escape(&ma);
+            mc = ma.transpose();
+            escape(&mc);
+        }), 0);
+        report("transpose", N, "eigen", timeIt([&] {
+            escape(&ea);
+            ec = ea.transpose();
+            escape(&ec);
+        }), 0);
+        report("transpose", N, "naive", timeIt([&] {
+            escape(na);
+            naiveTrans<N>(na, nc);
+            escape(nc);
+        }), 0);
+
+        report("inverse", N, "matrixf", timeIt([&] {
+            escape(&ma);
+            mc = ma.inverse();
+            escape(&mc);
+        }), mult_flops);
+        report("inverse", N, "eigen", timeIt([&] {
+            escape(&ea);
+            ec = ea.inverse();
+            escape(&ec);
+        }), mult_flops);
+        report("inverse", N, "naive", timeIt([&] {
+            escape(na);
+            naiveInverse<N>(na, nc);
+            escape(nc);
+        }), mult_flops);
+
+        report("norm", N, "matrixf", timeIt([&] {
+            escape(&ma);
+            s = ma.norm();
+            escape(&s);
+        }), norm_flops);
+        report("norm", N, "eigen", timeIt([&] {
+            escape(&ea);
+            s = ea.norm();
+            escape(&s);
+        }), norm_flops);
+        report("norm", N, "naive", timeIt([&] {
+            escape(na);
+            s = naiveNorm<N>(na);
+            escape(&s);
+        }), norm_flops);
+    }
+
+    template<uint32_t... N>
+    void benchSizes(std::integer_sequence<uint32_t, N...>) {
+        (benchSize<N + 1>(), ...);
+    }
+
+}  // namespace
+
+int main() {
+    printf("# matrix backend id %d, small size %d\n", MATRIX_BACKEND, MATRIX_SMALL_SIZE);
+    printf("op,n,impl,ns,gflops\n");
+    benchSizes(std::make_integer_sequence<uint32_t, 12>{});
+    return 0;
+}
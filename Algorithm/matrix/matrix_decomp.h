@@ -0,0 +1,322 @@
+/**
+ ******************************************************************************
+ * @file    matrix_decomp.h
+ * @brief   Factorizations of Matrixf with factor-once, solve-many API.
+ *          LU with partial pivoting, Cholesky, LDL^T and Householder QR.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Usage:
+ *      auto llt = S.cholesky();
+ *      if (llt.status() == 0) { x = llt.solve(v); }
+ *
+ * solve() takes one or more right-hand sides as columns of b. Solving costs
+ * O(n^2) per column on top of the O(n^3) factorization done once, which is
+ * cheaper and better conditioned than S.inverse() * b.
+ * status() returns 0 on success, 0x01 if the matrix is singular (LU, QR),
+ * not positive definite (Cholesky) or has a zero pivot (LDL^T).
+ */
+
+#ifndef MATRIX_DECOMP_H
+#define MATRIX_DECOMP_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "matrix.h"
+
+namespace matrixf {
+
+// PA = LU, L has a unit diagonal, both are kept in one matrix
+    template<uint32_t _n>
+    class LU {
+    protected:
+        Matrixf<_n, _n> lu_;
+        uint32_t perm_[_n];
+        float sign_;
+        uint8_t status_;
+
+    public:
+        explicit LU(const Matrixf<_n, _n> &a) : lu_(a), sign_(1.0f), status_(0) {
+            for (uint32_t i = 0; i < _n; i++) { perm_[i] = i; }
+            for (uint32_t c = 0; c < _n; c++) {
+                uint32_t pivot = c;
+                float pmax = std::fabs(lu_(c, c));
+                for (uint32_t r = c + 1; r < _n; r++) {
+                    if (std::fabs(lu_(r, c)) > pmax) {
+                        pmax = std::fabs(lu_(r, c));
+                        pivot = r;
+                    }
+                }
+                if (pmax == 0.0f) {
+                    status_ = 0x01;
+                    continue;
+                }
+                if (pivot != c) {
+                    for (uint32_t k = 0; k < _n; k++) {
+                        float t = lu_(c, k);
+                        lu_(c, k) = lu_(pivot, k);
+                        lu_(pivot, k) = t;
+                    }
+                    uint32_t t = perm_[c];
+                    perm_[c] = perm_[pivot];
+                    perm_[pivot] = t;
+                    sign_ = -sign_;
+                }
+                float inv = 1.0f / lu_(c, c);
+                for (uint32_t r = c + 1; r < _n; r++) {
+                    float f = lu_(r, c) * inv;
+                    lu_(r, c) = f;
+                    for (uint32_t k = c + 1; k < _n; k++) { lu_(r, k) -= f * lu_(c, k); }
+                }
+            }
+        }
+
+        uint8_t status() const { return status_; }
+
+        float determinant() const {
+            float det = sign_;
+            for (uint32_t i = 0; i < _n; i++) { det *= lu_(i, i); }
+            return det;
+        }
+
+        // x = A^-1 * b
+        template<typename E>
+        Matrixf<_n, E::kCols> solve(const MatrixExpr<E> &b) const {
+            static_assert(E::kRows == _n, "Matrix size mismatch");
+            Matrixf<_n, E::kCols> x;
+            for (uint32_t j = 0; j < E::kCols; j++) {
+                // Forward substitution with the row permutation
+                for (uint32_t i = 0; i < _n; i++) {
+                    float acc = b(perm_[i], j);
+                    for (uint32_t k = 0; k < i; k++) { acc -= lu_(i, k) * x(k, j); }
+                    x(i, j) = acc;
+                }
+                // Back substitution
+                for (uint32_t i = _n; i-- > 0;) {
+                    float acc = x(i, j);
+                    for (uint32_t k = i + 1; k < _n; k++) { acc -= lu_(i, k) * x(k, j); }
+                    x(i, j) = acc / lu_(i, i);
+                }
+            }
+            return x;
+        }
+    };
+
+// A = LL^T, only the lower triangle of A is read
+    template<uint32_t _n>
+    class Cholesky {
+    protected:
+        Matrixf<_n, _n> l_;
+        uint8_t status_;
+
+    public:
+        explicit Cholesky(const Matrixf<_n, _n> &a) : l_(a), status_(0) {
+            for (uint32_t j = 0; j < _n; j++) {
+                float d = l_(j, j);
+                for (uint32_t k = 0; k < j; k++) { d -= l_(j, k) * l_(j, k); }
+                if (!(d > 0.0f)) {
+                    status_ = 0x01;
+                    d = 1.0f;
+                }
+                d = std::sqrt(d);
+                l_(j, j) = d;
+                float inv = 1.0f / d;
+                for (uint32_t i = j + 1; i < _n; i++) {
+                    float acc = l_(i, j);
+                    for (uint32_t k = 0; k < j; k++) { acc -= l_(i, k) * l_(j, k); }
+                    l_(i, j) = acc * inv;
+                    l_(j, i) = 0.0f;
+                }
+            }
+        }
+
+        uint8_t status() const { return status_; }
+
+        // Lower triangular factor
+        const Matrixf<_n, _n> &matrixL() const { return l_; }
+
+        float determinant() const {
+            float det = 1.0f;
+            for (uint32_t i = 0; i < _n; i++) { det *= l_(i, i); }
+            return det * det;
+        }
+
+        // x = A^-1 * b
+        template<typename E>
+        Matrixf<_n, E::kCols> solve(const MatrixExpr<E> &b) const {
+            static_assert(E::kRows == _n, "Matrix size mismatch");
+            Matrixf<_n, E::kCols> x;
+            for (uint32_t j = 0; j < E::kCols; j++) {
+                for (uint32_t i = 0; i < _n; i++) {
+                    float acc = b(i, j);
+                    for (uint32_t k = 0; k < i; k++) { acc -= l_(i, k) * x(k, j); }
+                    x(i, j) = acc / l_(i, i);
+                }
+                for (uint32_t i = _n; i-- > 0;) {
+                    float acc = x(i, j);
+                    for (uint32_t k = i + 1; k < _n; k++) { acc -= l_(k, i) * x(k, j); }
+                    x(i, j) = acc / l_(i, i);
+                }
+            }
+            return x;
+        }
+    };
+
+// A = LDL^T without square roots, only the lower triangle of A is read
+    template<uint32_t _n>
+    class LDLT {
+    protected:
+        Matrixf<_n, _n> l_;     // Unit lower triangle, D on the diagonal
+        uint8_t status_;
+
+    public:
+        explicit LDLT(const Matrixf<_n, _n> &a) : l_(a), status_(0) {
+            float ld[_n];
+            for (uint32_t j = 0; j < _n; j++) {
+                float d = l_(j, j);
+                for (uint32_t k = 0; k < j; k++) {
+                    ld[k] = l_(j, k) * l_(k, k);
+                    d -= l_(j, k) * ld[k];
+                }
+                if (d == 0.0f) {
+                    status_ = 0x01;
+                    d = 1.0f;
+                }
+                l_(j, j) = d;
+                float inv = 1.0f / d;
+                for (uint32_t i = j + 1; i < _n; i++) {
+                    float acc = l_(i, j);
+                    for (uint32_t k = 0; k < j; k++) { acc -= l_(i, k) * ld[k]; }
+                    l_(i, j) = acc * inv;
+                    l_(j, i) = 0.0f;
+                }
+            }
+        }
+
+        uint8_t status() const { return status_; }
+
+        // Element i of D
+        float vectorD(uint32_t i) const { return l_(i, i); }
+
+        float determinant() const {
+            float det = 1.0f;
+            for (uint32_t i = 0; i < _n; i++) { det *= l_(i, i); }
+            return det;
+        }
+
+        // x = A^-1 * b
+        template<typename E>
+        Matrixf<_n, E::kCols> solve(const MatrixExpr<E> &b) const {
+            static_assert(E::kRows == _n, "Matrix size mismatch");
+            Matrixf<_n, E::kCols> x;
+            for (uint32_t j = 0; j < E::kCols; j++) {
+                for (uint32_t i = 0; i < _n; i++) {
+                    float acc = b(i, j);
+                    for (uint32_t k = 0; k < i; k++) { acc -= l_(i, k) * x(k, j); }
+                    x(i, j) = acc;
+                }
+                for (uint32_t i = 0; i < _n; i++) { x(i, j) /= l_(i, i); }
+                for (uint32_t i = _n; i-- > 0;) {
+                    float acc = x(i, j);
+                    for (uint32_t k = i + 1; k < _n; k++) { acc -= l_(k, i) * x(k, j); }
+                    x(i, j) = acc;
+                }
+            }
+            return x;
+        }
+    };
+
+// A = QR by Householder reflections, A is _rows x _cols with _rows >= _cols
+    template<uint32_t _rows, uint32_t _cols>
+    class QR {
+    protected:
+        Matrixf<_rows, _cols> qr_;  // R above the diagonal, reflectors below
+        float rdiag_[_cols];
+        float sign_;
+        uint8_t status_;
+
+    public:
+        explicit QR(const Matrixf<_rows, _cols> &a) : qr_(a), sign_(1.0f), status_(0) {
+            static_assert(_rows >= _cols, "QR needs rows >= cols");
+            for (uint32_t k = 0; k < _cols; k++) {
+                float nrm = 0.0f;
+                for (uint32_t i = k; i < _rows; i++) { nrm = std::hypot(nrm, qr_(i, k)); }
+                if (nrm == 0.0f) {
+                    rdiag_[k] = 0.0f;
+                    status_ = 0x01;
+                    continue;
+                }
+                if (qr_(k, k) < 0) { nrm = -nrm; }
+                for (uint32_t i = k; i < _rows; i++) { qr_(i, k) /= nrm; }
+                qr_(k, k) += 1.0f;
+                // Every reflection flips the sign of the determinant
+                sign_ = -sign_;
+                for (uint32_t j = k + 1; j < _cols; j++) {
+                    float s = 0.0f;
+                    for (uint32_t i = k; i < _rows; i++) { s += qr_(i, k) * qr_(i, j); }
+                    s = -s / qr_(k, k);
+                    for (uint32_t i = k; i < _rows; i++) { qr_(i, j) += s * qr_(i, k); }
+                }
+                rdiag_[k] = -nrm;
+            }
+        }
+
+        uint8_t status() const { return status_; }
+
+        // Only for square matrix
+        float determinant() const {
+            static_assert(_rows == _cols, "Only square matrix has determinant");
+            float det = sign_;
+            for (uint32_t i = 0; i < _cols; i++) { det *= rdiag_[i]; }
+            return det;
+        }
+
+        // Least squares x = argmin |A*x - b|, exact solution for square A
+        template<typename E>
+        Matrixf<_cols, E::kCols> solve(const MatrixExpr<E> &b) const {
+            static_assert(E::kRows == _rows, "Matrix size mismatch");
+            Matrixf<_rows, E::kCols> y(b);
+            Matrixf<_cols, E::kCols> x;
+            for (uint32_t j = 0; j < E::kCols; j++) {
+                // y = Q^T * b
+                for (uint32_t k = 0; k < _cols; k++) {
+                    if (rdiag_[k] == 0.0f) { continue; }
+                    float s = 0.0f;
+                    for (uint32_t i = k; i < _rows; i++) { s += qr_(i, k) * y(i, j); }
+                    s = -s / qr_(k, k);
+                    for (uint32_t i = k; i < _rows; i++) { y(i, j) += s * qr_(i, k); }
+                }
+                // R * x = y
+                for (uint32_t k = _cols; k-- > 0;) {
+                    float acc = y(k, j);
+                    for (uint32_t i = k + 1; i < _cols; i++) { acc -= qr_(k, i) * x(i, j); }
+                    x(k, j) = rdiag_[k] == 0.0f ? 0.0f : acc / rdiag_[k];
+                }
+            }
+            return x;
+        }
+    };
+
+/* Factorization entry points of Matrixf */
+    template<uint32_t _rows, uint32_t _cols>
+    LU<_rows> Matrixf<_rows, _cols>::lu() const { return LU<_rows>(*this); }
+
+    template<uint32_t _rows, uint32_t _cols>
+    Cholesky<_rows> Matrixf<_rows, _cols>::cholesky() const { return Cholesky<_rows>(*this); }
+
+    template<uint32_t _rows, uint32_t _cols>
+    LDLT<_rows> Matrixf<_rows, _cols>::ldlt() const { return LDLT<_rows>(*this); }
+
+    template<uint32_t _rows, uint32_t _cols>
+    QR<_rows, _cols> Matrixf<_rows, _cols>::qr() const { return QR<_rows, _cols>(*this); }
+
+}  // namespace matrixf
+
+#endif  // MATRIX_DECOMP_H
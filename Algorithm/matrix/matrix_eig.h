@@ -0,0 +1,328 @@
+/**
+ ******************************************************************************
+ * @file    matrix_eig.h
+ * @brief   Eigen and singular value decompositions of small Matrixf.
+ *          Closed-form eigensolver of 3x3 symmetric matrices and one-sided
+ *          Jacobi SVD, meant for on-target calibration fits.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Usage:
+ *      auto eig = M.symEig();              // M is 3x3 symmetric
+ *      eig.eigenvalues();                  // ascending
+ *      eig.eigenvectors();                 // columns, right-handed
+ *
+ *      auto svd = A.svd();                 // rows >= cols
+ *      A == svd.matrixU() * Diag(svd.singularValues()) * svd.matrixV()^T
+ *
+ * SymEig3 is not iterative: the eigenvalues come from the trigonometric
+ * solution of the characteristic cubic and the eigenvectors from cross
+ * products, after D. Eberly, "A Robust Eigensolver for 3x3 Symmetric
+ * Matrices". About 150 flops, sqrt, acos and cos.
+ * SVD rotates column pairs of A until they are orthogonal, a handful of
+ * sweeps for up to 6 columns, and is accurate for small singular values.
+ */
+
+#ifndef MATRIX_EIG_H
+#define MATRIX_EIG_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "matrix.h"
+
+namespace matrixf {
+
+// A = V * diag(d) * V^T of a symmetric 3x3 matrix, only the upper triangle is read
+    class SymEig3 {
+    protected:
+        Matrixf<3, 1> d_;
+        Matrixf<3, 3> v_;
+
+        static float dot3(const float *a, const float *b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+        static void cross3(const float *a, const float *b, float *res) {
+            res[0] = a[1] * b[2] - a[2] * b[1];
+            res[1] = a[2] * b[0] - a[0] * b[2];
+            res[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        // Unit vector of the null space of a - eval*I, eval is a simple root
+        static void vector0(const float *a, float eval, float *res) {
+            const float r0[3] = {a[0] - eval, a[1], a[2]};
+            const float r1[3] = {a[1], a[4] - eval, a[5]};
+            const float r2[3] = {a[2], a[5], a[8] - eval};
+            float c[3][3];
+            cross3(r0, r1, c[0]);
+            cross3(r0, r2, c[1]);
+            cross3(r1, r2, c[2]);
+            // The longest cross product of two rows is the best conditioned
+            uint32_t imax = 0;
+            float dmax = dot3(c[0], c[0]);
+            for (uint32_t i = 1; i < 3; i++) {
+                float d = dot3(c[i], c[i]);
+                if (d > dmax) {
+                    dmax = d;
+                    imax = i;
+                }
+            }
+            if (dmax > 0.0f) {
+                float inv = 1.0f / std::sqrt(dmax);
+                for (uint32_t i = 0; i < 3; i++) { res[i] = c[imax][i] * inv; }
+            } else {
+                res[0] = 1.0f;
+                res[1] = 0.0f;
+                res[2] = 0.0f;
+            }
+        }
+
+        // Unit eigenvector of eval orthogonal to v0, solved in the plane normal to v0
+        static void vector1(const float *a, const float *v0, float eval, float *res) {
+            // u, w span the plane orthogonal to v0
+            float u[3], w[3];
+            if (std::fabs(v0[0]) > std::fabs(v0[1])) {
+                float inv = 1.0f / std::sqrt(v0[0] * v0[0] + v0[2] * v0[2]);
+                u[0] = -v0[2] * inv;
+                u[1] = 0.0f;
+                u[2] = v0[0] * inv;
+            } else {
+                float inv = 1.0f / std::sqrt(v0[1] * v0[1] + v0[2] * v0[2]);
+                u[0] = 0.0f;
+                u[1] = v0[2] * inv;
+                u[2] = -v0[1] * inv;
+            }
+            cross3(v0, u, w);
+            const float au[3] = {a[0] * u[0] + a[1] * u[1] + a[2] * u[2],
+                                 a[1] * u[0] + a[4] * u[1] + a[5] * u[2],
+                                 a[2] * u[0] + a[5] * u[1] + a[8] * u[2]};
+            const float aw[3] = {a[0] * w[0] + a[1] * w[1] + a[2] * w[2],
+                                 a[1] * w[0] + a[4] * w[1] + a[5] * w[2],
+                                 a[2] * w[0] + a[5] * w[1] + a[8] * w[2]};
+            // 2x2 matrix [u w]^T (A - eval*I) [u w]
+            float m00 = dot3(u, au) - eval, m01 = dot3(u, aw), m11 = dot3(w, aw) - eval;
+            // Null vector of the row with the larger entry, u itself if both rows vanish
+            float r0 = std::fmax(std::fabs(m00), std::fabs(m01));
+            float r1 = std::fmax(std::fabs(m01), std::fabs(m11));
+            float cu = r0 >= r1 ? -m01 : -m11;
+            float cw = r0 >= r1 ? m00 : m01;
+            float len2 = cu * cu + cw * cw;
+            if (len2 > 0.0f) {
+                float inv = 1.0f / std::sqrt(len2);
+                cu *= inv;
+                cw *= inv;
+            } else {
+                cu = 1.0f;
+                cw = 0.0f;
+            }
+            for (uint32_t i = 0; i < 3; i++) { res[i] = cu * u[i] + cw * w[i]; }
+        }
+
+    public:
+        explicit SymEig3(const Matrixf<3, 3> &m) {
+            // Scale to unit max element against overflow
+            float amax = 0.0f;
+            for (uint32_t i = 0; i < 3; i++) {
+                for (uint32_t j = i; j < 3; j++) { amax = std::fmax(amax, std::fabs(m(i, j))); }
+            }
+            float a[9] = {};
+            float eval[3] = {};
+            float evec[3][3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+            if (amax > 0.0f) {
+                float inv = 1.0f / amax;
+                for (uint32_t i = 0; i < 3; i++) {
+                    for (uint32_t j = i; j < 3; j++) { a[i * 3 + j] = a[j * 3 + i] = m(i, j) * inv; }
+                }
+                float off = a[1] * a[1] + a[2] * a[2] + a[5] * a[5];
+                if (off > 0.0f) {
+                    float q = (a[0] + a[4] + a[8]) / 3.0f;
+                    float b00 = a[0] - q, b11 = a[4] - q, b22 = a[8] - q;
+                    float p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0f * off) / 6.0f);
+                    float c00 = b11 * b22 - a[5] * a[5];
+                    float c01 = a[1] * b22 - a[5] * a[2];
+                    float c02 = a[1] * a[5] - b11 * a[2];
+                    float half_det = 0.5f * (b00 * c00 - a[1] * c01 + a[2] * c02) / (p * p * p);
+                    half_det = std::fmin(std::fmax(half_det, -1.0f), 1.0f);
+                    // Roots 2cos(angle + 2k*pi/3) of the cubic of (A - q*I)/p, ascending
+                    float angle = std::acos(half_det) / 3.0f;
+                    float beta2 = 2.0f * std::cos(angle);
+                    float beta0 = 2.0f * std::cos(angle + 2.0943951023931955f);
+                    float beta1 = -(beta0 + beta2);
+                    eval[0] = q + p * beta0;
+                    eval[1] = q + p * beta1;
+                    eval[2] = q + p * beta2;
+                    // Start from the root farthest from the middle one
+                    if (half_det >= 0.0f) {
+                        vector0(a, eval[2], evec[2]);
+                        vector1(a, evec[2], eval[1], evec[1]);
+                        cross3(evec[1], evec[2], evec[0]);
+                    } else {
+                        vector0(a, eval[0], evec[0]);
+                        vector1(a, evec[0], eval[1], evec[1]);
+                        cross3(evec[0], evec[1], evec[2]);
+                    }
+                }
+                // Rayleigh quotients, the roots of a near double eigenvalue lose half the digits in acos.
+                // A diagonal A keeps the identity vectors and gets its diagonal here
+                for (uint32_t i = 0; i < 3; i++) {
+                    const float *e = evec[i];
+                    eval[i] = a[0] * e[0] * e[0] + a[4] * e[1] * e[1] + a[8] * e[2] * e[2] +
+                              2.0f * (a[1] * e[0] * e[1] + a[2] * e[0] * e[2] + a[5] * e[1] * e[2]);
+                }
+                // Ascending, then keep the basis right-handed
+                for (uint32_t i = 0; i < 2; i++) {
+                    for (uint32_t j = 0; j < 2 - i; j++) {
+                        if (eval[j] > eval[j + 1]) {
+                            float t = eval[j];
+                            eval[j] = eval[j + 1];
+                            eval[j + 1] = t;
+                            for (uint32_t k = 0; k < 3; k++) {
+                                t = evec[j][k];
+                                evec[j][k] = evec[j + 1][k];
+                                evec[j + 1][k] = t;
+                            }
+                        }
+                    }
+                }
+                cross3(evec[0], evec[1], evec[2]);
+            }
+            for (uint32_t i = 0; i < 3; i++) {
+                d_(i, 0) = eval[i] * amax;
+                for (uint32_t k = 0; k < 3; k++) { v_(k, i) = evec[i][k]; }
+            }
+        }
+
+        // Ascending
+        const Matrixf<3, 1> &eigenvalues() const { return d_; }
+
+        // Unit eigenvectors as columns, in the order of eigenvalues()
+        const Matrixf<3, 3> &eigenvectors() const { return v_; }
+    };
+
+// A = U * diag(s) * V^T by one-sided Jacobi, A is _rows x _cols with _rows >= _cols
+    template<uint32_t _rows, uint32_t _cols>
+    class SVD {
+    protected:
+        Matrixf<_rows, _cols> u_;
+        Matrixf<_cols, 1> s_;
+        Matrixf<_cols, _cols> v_;
+        uint8_t status_;
+
+        static constexpr uint32_t kMaxSweeps = 30;
+
+    public:
+        explicit SVD(const Matrixf<_rows, _cols> &a) : u_(a), v_(Eye<_cols, _cols>()), status_(0x01) {
+            static_assert(_rows >= _cols, "SVD needs rows >= cols");
+            for (uint32_t sweep = 0; sweep < kMaxSweeps && status_; sweep++) {
+                status_ = 0;
+                for (uint32_t p = 0; p + 1 < _cols; p++) {
+                    for (uint32_t q = p + 1; q < _cols; q++) {
+                        float alpha = 0.0f, beta = 0.0f, gamma = 0.0f;
+                        for (uint32_t i = 0; i < _rows; i++) {
+                            alpha += u_(i, p) * u_(i, p);
+                            beta += u_(i, q) * u_(i, q);
+                            gamma += u_(i, p) * u_(i, q);
+                        }
+                        // Columns p and q are orthogonal to working precision
+                        if (std::fabs(gamma) <= 1e-6f * std::sqrt(alpha * beta)) { continue; }
+                        status_ = 0x01;
+                        // Rotation which zeroes the dot product of the two columns
+                        float zeta = (beta - alpha) / (2.0f * gamma);
+                        float t = std::copysign(1.0f, zeta) / (std::fabs(zeta) + std::sqrt(1.0f + zeta * zeta));
+                        float c = 1.0f / std::sqrt(1.0f + t * t);
+                        float s = c * t;
+                        for (uint32_t i = 0; i < _rows; i++) {
+                            float up = u_(i, p), uq = u_(i, q);
+                            u_(i, p) = c * up - s * uq;
+                            u_(i, q) = s * up + c * uq;
+                        }
+                        for (uint32_t i = 0; i < _cols; i++) {
+                            float vp = v_(i, p), vq = v_(i, q);
+                            v_(i, p) = c * vp - s * vq;
+                            v_(i, q) = s * vp + c * vq;
+                        }
+                    }
+                }
+            }
+            // Column norms are the singular values
+            for (uint32_t j = 0; j < _cols; j++) {
+                float nrm = 0.0f;
+                for (uint32_t i = 0; i < _rows; i++) { nrm += u_(i, j) * u_(i, j); }
+                nrm = std::sqrt(nrm);
+                s_(j, 0) = nrm;
+                float inv = nrm > 0.0f ? 1.0f / nrm : 0.0f;
+                for (uint32_t i = 0; i < _rows; i++) { u_(i, j) *= inv; }
+            }
+            // Descending order
+            for (uint32_t j = 0; j + 1 < _cols; j++) {
+                uint32_t jmax = j;
+                for (uint32_t k = j + 1; k < _cols; k++) {
+                    if (s_(k, 0) > s_(jmax, 0)) { jmax = k; }
+                }
+                if (jmax == j) { continue; }
+                float t = s_(j, 0);
+                s_(j, 0) = s_(jmax, 0);
+                s_(jmax, 0) = t;
+                for (uint32_t i = 0; i < _rows; i++) {
+                    t = u_(i, j);
+                    u_(i, j) = u_(i, jmax);
+                    u_(i, jmax) = t;
+                }
+                for (uint32_t i = 0; i < _cols; i++) {
+                    t = v_(i, j);
+                    v_(i, j) = v_(i, jmax);
+                    v_(i, jmax) = t;
+                }
+            }
+        }
+
+        // 0 if the sweeps converged, 0x01 otherwise
+        uint8_t status() const { return status_; }
+
+        // Descending, non-negative
+        const Matrixf<_cols, 1> &singularValues() const { return s_; }
+
+        // Left singular vectors as columns, zero for a zero singular value
+        const Matrixf<_rows, _cols> &matrixU() const { return u_; }
+
+        // Right singular vectors as columns
+        const Matrixf<_cols, _cols> &matrixV() const { return v_; }
+
+        // Number of singular values above tol * largest
+        uint32_t rank(float tol = 1e-6f) const {
+            uint32_t r = 0;
+            for (uint32_t j = 0; j < _cols; j++) { r += s_(j, 0) > tol * s_(0, 0); }
+            return r;
+        }
+
+        // Minimum norm least squares x = V * diag(1/s) * U^T * b, s below tol * largest dropped
+        template<typename E>
+        Matrixf<_cols, E::kCols> solve(const MatrixExpr<E> &b, float tol = 1e-6f) const {
+            static_assert(E::kRows == _rows, "Matrix size mismatch");
+            Matrixf<_cols, E::kCols> y(u_.transpose() * b);
+            for (uint32_t j = 0; j < _cols; j++) {
+                float inv = s_(j, 0) > tol * s_(0, 0) ? 1.0f / s_(j, 0) : 0.0f;
+                for (uint32_t k = 0; k < E::kCols; k++) { y(j, k) *= inv; }
+            }
+            return v_ * y;
+        }
+    };
+
+/* Decomposition entry points of Matrixf */
+    template<uint32_t _rows, uint32_t _cols>
+    SymEig3 Matrixf<_rows, _cols>::symEig() const {
+        static_assert(_rows == 3 && _cols == 3, "Closed-form eigensolver is 3x3 only");
+        return SymEig3(*this);
+    }
+
+    template<uint32_t _rows, uint32_t _cols>
+    SVD<_rows, _cols> Matrixf<_rows, _cols>::svd() const { return SVD<_rows, _cols>(*this); }
+
+}  // namespace matrixf
+
+#endif  // MATRIX_EIG_H
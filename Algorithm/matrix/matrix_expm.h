@@ -0,0 +1,149 @@
+/**
+ ******************************************************************************
+ * @file    matrix_expm.h
+ * @brief   Matrix exponential and discretization of linear models.
+ *          Scaling-and-squaring Pade expm() and Van Loan c2d(), with a
+ *          cached model for a fixed step.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Usage:
+ *      // x' = A*x + B*u + w, w white with spectral density Qc
+ *      auto d = c2d(A, B, Qc, dt);         // d.F = e^(A*dt), d.B, d.Q
+ *
+ *      // fixed dt, discretized once
+ *      static DiscreteModel<4, 1> model(A, B, Qc, 0.001f);
+ *      x = model.predict(x, u);            // F*x + B*u
+ *      model.propagate(P);                 // P = F*P*F^T + Qd
+ *
+ * expm() picks the Pade degree 3, 5 or 7 from the 1-norm of A with the
+ * single precision bounds of N. J. Higham, "The Scaling and Squaring Method
+ * for the Matrix Exponential Revisited", and squares back after scaling
+ * larger A down. c2d() takes one exponential of size n+m for F and B and
+ * one of size 2n for Qd, so call it at init or when dt changes; a 6 state
+ * model needs a 12x12 exponential and a few kB of stack.
+ */
+
+#ifndef MATRIX_EXPM_H
+#define MATRIX_EXPM_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "matrix.h"
+
+namespace matrixf {
+
+    template<uint32_t _rows, uint32_t _cols>
+    Matrixf<_rows, _cols> Matrixf<_rows, _cols>::expm() const {
+        static_assert(_rows == _cols, "Only square matrix has exponential");
+        constexpr uint32_t n = _rows;
+        // 1-norm, the largest column sum
+        float norm = 0.0f;
+        for (uint32_t j = 0; j < n; j++) {
+            float sum = 0.0f;
+            for (uint32_t i = 0; i < n; i++) { sum += std::fabs((*this)(i, j)); }
+            norm = std::fmax(norm, sum);
+        }
+        // Largest norms for which Pade degree 3, 5, 7 reaches float precision
+        constexpr float kTheta3 = 4.258730016922831e-1f;
+        constexpr float kTheta5 = 1.880152677804762f;
+        constexpr float kTheta7 = 3.925724783138660f;
+        int s = 0;
+        if (norm > kTheta7) { std::frexp(norm / kTheta7, &s); }
+        Matrixf<n, n> a(*this * std::ldexp(1.0f, -s));
+        Matrixf<n, n> a2(a * a);
+        Matrixf<n, n> u, v;
+        // exp(A) = (V - U)^-1 * (V + U), U odd and V even in A
+        if (norm <= kTheta3) {
+            u = a * (a2 + Eye<n, n>() * 60.0f);
+            v = a2 * 12.0f + Eye<n, n>() * 120.0f;
+        } else if (norm <= kTheta5) {
+            Matrixf<n, n> a4(a2 * a2);
+            u = a * (a4 + a2 * 420.0f + Eye<n, n>() * 15120.0f);
+            v = a4 * 30.0f + a2 * 3360.0f + Eye<n, n>() * 30240.0f;
+        } else {
+            Matrixf<n, n> a4(a2 * a2);
+            Matrixf<n, n> a6(a4 * a2);
+            u = a * (a6 + a4 * 1512.0f + a2 * 277200.0f + Eye<n, n>() * 8648640.0f);
+            v = a6 * 56.0f + a4 * 25200.0f + a2 * 1995840.0f + Eye<n, n>() * 17297280.0f;
+        }
+        Matrixf<n, n> res(Matrixf<n, n>(v - u).lu().solve(v + u));
+        for (int i = 0; i < s; i++) { res = res * res; }
+        return res;
+    }
+
+// Discrete model x[k+1] = F*x[k] + B*u[k] + w[k], cov(w) = Q
+    template<uint32_t _n, uint32_t _m>
+    struct Discrete {
+        Matrixf<_n, _n> F;
+        Matrixf<_n, _m> B;
+        Matrixf<_n, _n> Q;
+    };
+
+/**
+ * Zero order hold discretization of x' = A*x + B*u + w, Qc the spectral
+ * density of w. F and B are blocks of exp([A B; 0 0]*dt), Qd comes from
+ * exp([-A Qc; 0 A^T]*dt) by Van Loan's method.
+ */
+    template<uint32_t _n, uint32_t _m>
+    Discrete<_n, _m> c2d(const Matrixf<_n, _n> &A, const Matrixf<_n, _m> &B, const Matrixf<_n, _n> &Qc, float dt) {
+        Discrete<_n, _m> res;
+        Matrixf<_n + _m, _n + _m> mb{};
+        mb.template block<_n, _n>(0, 0) = A * dt;
+        mb.template block<_n, _m>(0, _n) = B * dt;
+        Matrixf<_n + _m, _n + _m> eb(mb.expm());
+        res.F = eb.template block<_n, _n>(0, 0);
+        res.B = eb.template block<_n, _m>(0, _n);
+
+        Matrixf<2 * _n, 2 * _n> mq{};
+        mq.template block<_n, _n>(0, 0) = A * (-dt);
+        mq.template block<_n, _n>(0, _n) = Qc * dt;
+        mq.template block<_n, _n>(_n, _n) = A.transpose() * dt;
+        Matrixf<2 * _n, 2 * _n> eq(mq.expm());
+        // Lower right block is F^T, Qd = F * upper right
+        res.Q = res.F * eq.template block<_n, _n>(0, _n);
+        // Symmetric up to rounding, keep it exactly so
+        res.Q = (res.Q + res.Q.transpose()) * 0.5f;
+        return res;
+    }
+
+// Model discretized once for a fixed step, predicting costs one multiply
+    template<uint32_t _n, uint32_t _m>
+    class DiscreteModel {
+    protected:
+        Discrete<_n, _m> d_;
+
+    public:
+        DiscreteModel(const Matrixf<_n, _n> &A, const Matrixf<_n, _m> &B, const Matrixf<_n, _n> &Qc, float dt)
+                : d_(c2d(A, B, Qc, dt)) {}
+
+        // Discretize again, e.g. after the sample rate changed
+        void setDt(const Matrixf<_n, _n> &A, const Matrixf<_n, _m> &B, const Matrixf<_n, _n> &Qc, float dt) {
+            d_ = c2d(A, B, Qc, dt);
+        }
+
+        const Matrixf<_n, _n> &F() const { return d_.F; }
+
+        const Matrixf<_n, _m> &B() const { return d_.B; }
+
+        const Matrixf<_n, _n> &Q() const { return d_.Q; }
+
+        // F*x + B*u
+        Matrixf<_n, 1> predict(const Matrixf<_n, 1> &x, const Matrixf<_m, 1> &u) const {
+            return d_.F * x + d_.B * u;
+        }
+
+        // P = F*P*F^T + Qd
+        void propagate(Matrixf<_n, _n> &P) const { P = d_.F * P * d_.F.transpose() + d_.Q; }
+    };
+
+}  // namespace matrixf
+
+#endif  // MATRIX_EXPM_H
@@ -0,0 +1,271 @@
+/**
+ ******************************************************************************
+ * @file    matrix_expr.h
+ * @brief   Lazy expression templates of matrix.h.
+ *          Sums, differences, scalings, transposes and products are kept as
+ *          light nodes and evaluated in one loop nest when assigned.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Every node exposes:
+ *      kRows, kCols    size of the result
+ *      kDirect         coeff() is a plain load, cheap to read many times
+ *      coeff(i,j)      value of one element
+ *      overlaps(d)     whether any operand shares memory with destination d
+ *      aliases(d)      whether writing d element by element would change an
+ *                      operand before it is read, true for any overlap under
+ *                      a transpose or product, and for a sum or scaling only
+ *                      if the operand is not laid out exactly as d
+ *
+ * An operand of a product which is not kDirect is evaluated once into a
+ * Matrixf when the product node is built, otherwise its elements would be
+ * recomputed for every output element. So F*P*F.transpose()+Q keeps one
+ * temporary for F*P and fuses the rest into the final assignment.
+ *
+ * Nodes hold their operands by reference, do not store an expression with
+ * auto, assign it to a Matrixf in the same statement.
+ */
+
+#ifndef MATRIX_EXPR_H
+#define MATRIX_EXPR_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "matrix_backend.h"
+#include "matrix_small.h"
+
+namespace matrixf {
+    template<uint32_t _rows, uint32_t _cols>
+    class Matrixf;
+
+    template<typename E>
+    struct IsMatrixf : std::false_type {
+    };
+
+    template<uint32_t _rows, uint32_t _cols>
+    struct IsMatrixf<Matrixf<_rows, _cols>> : std::true_type {
+    };
+
+    // How a product keeps its operand: evaluated into a Matrixf unless direct
+    template<typename E>
+    using ProductNested = typename std::conditional<E::kDirect, const E &,
+            const Matrixf<E::kRows, E::kCols>>::type;
+
+    // Memory written by an assignment, element (i,j) at ptr[i*stride+j]
+    struct ExprDst {
+        const float *ptr;
+        const float *end;
+        uint32_t stride;
+
+        // Whether leaf storage [lo,hi) overlaps
+        bool overlaps(const float *lo, const float *hi) const { return lo < end && ptr < hi; }
+
+        // Whether leaf storage [lo,hi) with row stride step overlaps in another layout
+        bool aliases(const float *lo, const float *hi, uint32_t step) const {
+            return overlaps(lo, hi) && !(lo == ptr && step == stride);
+        }
+    };
+
+// Base of all matrix expressions
+    template<typename Derived>
+    class MatrixExpr {
+    public:
+        constexpr const Derived &derived() const { return *static_cast<const Derived *>(this); }
+
+        constexpr float operator()(const uint32_t &row, const uint32_t &col) const {
+            return derived().coeff(row, col);
+        }
+
+        // Write all elements into dst[i*stride+j], dst is not an operand
+        constexpr void evalTo(float *dst, uint32_t stride = Derived::kCols) const {
+            const Derived &e = derived();
+            if constexpr (small::kEnable<Derived::kRows, Derived::kCols>) {
+                small::unroll<Derived::kRows>([&](auto i) MATRIX_LAMBDA_INLINE {
+                    small::unroll<Derived::kCols>([&](auto j) MATRIX_LAMBDA_INLINE { dst[i * stride + j] = e.coeff(i, j); });
+                });
+            } else {
+                for (uint32_t i = 0; i < Derived::kRows; i++) {
+                    for (uint32_t j = 0; j < Derived::kCols; j++) {
+                        dst[i * stride + j] = e.coeff(i, j);
+                    }
+                }
+            }
+        }
+    };
+
+    // dst[i*stride+j] = e(i,j), through a temporary if e reads dst, see aliases()
+    template<typename E>
+    constexpr void assignTo(float *dst, uint32_t stride, const E &e) {
+        const ExprDst d = {dst, dst + (E::kRows - 1) * stride + E::kCols, stride};
+        // Pointers of different objects do not compare in a constant expression
+        if (MATRIX_CONSTEVAL() || e.aliases(d)) {
+            const Matrixf<E::kRows, E::kCols> tmp(e);
+            tmp.evalTo(dst, stride);
+        } else {
+            e.evalTo(dst, stride);
+        }
+    }
+
+// Transpose
+    template<typename E>
+    class TransposeExpr : public MatrixExpr<TransposeExpr<E>> {
+        const E &e_;
+
+    public:
+        static constexpr uint32_t kRows = E::kCols;
+        static constexpr uint32_t kCols = E::kRows;
+        static constexpr bool kDirect = E::kDirect;
+
+        constexpr explicit TransposeExpr(const E &e) : e_(e) {}
+
+        MATRIX_INLINE constexpr float coeff(uint32_t i, uint32_t j) const { return e_.coeff(j, i); }
+
+        bool overlaps(const ExprDst &d) const { return e_.overlaps(d); }
+
+        bool aliases(const ExprDst &d) const { return e_.overlaps(d); }
+
+        constexpr const E &transpose() const { return e_; }
+    };
+
+// Element-wise sum and difference
+    template<typename L, typename R, bool _sub>
+    class SumExpr : public MatrixExpr<SumExpr<L, R, _sub>> {
+        const L &l_;
+        const R &r_;
+
+    public:
+        static_assert(L::kRows == R::kRows && L::kCols == R::kCols, "Matrix size mismatch");
+        static constexpr uint32_t kRows = L::kRows;
+        static constexpr uint32_t kCols = L::kCols;
+        static constexpr bool kDirect = false;
+
+        constexpr SumExpr(const L &l, const R &r) : l_(l), r_(r) {}
+
+        MATRIX_INLINE constexpr float coeff(uint32_t i, uint32_t j) const {
+            return _sub ? l_.coeff(i, j) - r_.coeff(i, j) : l_.coeff(i, j) + r_.coeff(i, j);
+        }
+
+        bool overlaps(const ExprDst &d) const { return l_.overlaps(d) || r_.overlaps(d); }
+
+        bool aliases(const ExprDst &d) const { return l_.aliases(d) || r_.aliases(d); }
+
+        constexpr TransposeExpr<SumExpr> transpose() const { return TransposeExpr<SumExpr>(*this); }
+    };
+
+// Multiply by scalar
+    template<typename E>
+    class ScaleExpr : public MatrixExpr<ScaleExpr<E>> {
+        const E &e_;
+        float k_;
+
+    public:
+        static constexpr uint32_t kRows = E::kRows;
+        static constexpr uint32_t kCols = E::kCols;
+        static constexpr bool kDirect = false;
+
+        constexpr ScaleExpr(const E &e, float k) : e_(e), k_(k) {}
+
+        MATRIX_INLINE constexpr float coeff(uint32_t i, uint32_t j) const { return e_.coeff(i, j) * k_; }
+
+        bool overlaps(const ExprDst &d) const { return e_.overlaps(d); }
+
+        bool aliases(const ExprDst &d) const { return e_.aliases(d); }
+
+        constexpr TransposeExpr<ScaleExpr> transpose() const { return TransposeExpr<ScaleExpr>(*this); }
+    };
+
+// Matrix product
+    template<typename L, typename R>
+    class ProductExpr : public MatrixExpr<ProductExpr<L, R>> {
+        ProductNested<L> l_;
+        ProductNested<R> r_;
+
+    public:
+        static_assert(L::kCols == R::kRows, "Matrix size mismatch");
+        static constexpr uint32_t kRows = L::kRows;
+        static constexpr uint32_t kCols = R::kCols;
+        static constexpr bool kDirect = false;
+
+        constexpr ProductExpr(const L &l, const R &r) : l_(l), r_(r) {}
+
+        MATRIX_INLINE constexpr float coeff(uint32_t i, uint32_t j) const {
+            float res = 0.0f;
+            if constexpr (L::kCols <= MATRIX_SMALL_SIZE) {
+                small::unroll<L::kCols>([&](auto k) MATRIX_LAMBDA_INLINE { res += l_.coeff(i, k) * r_.coeff(k, j); });
+            } else {
+                for (uint32_t k = 0; k < L::kCols; k++) {
+                    res += l_.coeff(i, k) * r_.coeff(k, j);
+                }
+            }
+            return res;
+        }
+
+        bool overlaps(const ExprDst &d) const { return l_.overlaps(d) || r_.overlaps(d); }
+
+        bool aliases(const ExprDst &d) const { return l_.overlaps(d) || r_.overlaps(d); }
+
+        constexpr void evalTo(float *dst, uint32_t stride = kCols) const {
+            using LN = typename std::decay<ProductNested<L>>::type;
+            using RN = typename std::decay<ProductNested<R>>::type;
+            constexpr bool dense = IsMatrixf<LN>::value && IsMatrixf<RN>::value;
+            if (dense && stride == kCols && !MATRIX_CONSTEVAL()) {
+                // Two dense operands into a dense destination, let the kernels do it
+                if constexpr (dense && small::kEnable<kRows, L::kCols> && small::kEnable<L::kCols, kCols>) {
+                    small::mult<kRows, L::kCols, kCols>(l_.data(), r_.data(), dst);
+                } else if constexpr (dense) {
+                    backend::mult(l_.data(), r_.data(), dst, kRows, L::kCols, kCols);
+                }
+            } else {
+                MatrixExpr<ProductExpr>::evalTo(dst, stride);
+            }
+        }
+
+        constexpr TransposeExpr<ProductExpr> transpose() const { return TransposeExpr<ProductExpr>(*this); }
+    };
+
+/* Operators */
+    template<typename L, typename R>
+    constexpr SumExpr<L, R, false> operator+(const MatrixExpr<L> &l, const MatrixExpr<R> &r) {
+        return SumExpr<L, R, false>(l.derived(), r.derived());
+    }
+
+    template<typename L, typename R>
+    constexpr SumExpr<L, R, true> operator-(const MatrixExpr<L> &l, const MatrixExpr<R> &r) {
+        return SumExpr<L, R, true>(l.derived(), r.derived());
+    }
+
+    template<typename E>
+    constexpr ScaleExpr<E> operator-(const MatrixExpr<E> &e) {
+        return ScaleExpr<E>(e.derived(), -1.0f);
+    }
+
+    template<typename E>
+    constexpr ScaleExpr<E> operator*(const MatrixExpr<E> &e, const float &val) {
+        return ScaleExpr<E>(e.derived(), val);
+    }
+
+    template<typename E>
+    constexpr ScaleExpr<E> operator*(const float &val, const MatrixExpr<E> &e) {
+        return ScaleExpr<E>(e.derived(), val);
+    }
+
+    template<typename E>
+    constexpr ScaleExpr<E> operator/(const MatrixExpr<E> &e, const float &val) {
+        return ScaleExpr<E>(e.derived(), 1.f / val);
+    }
+
+    template<typename L, typename R>
+    constexpr ProductExpr<L, R> operator*(const MatrixExpr<L> &l, const MatrixExpr<R> &r) {
+        return ProductExpr<L, R>(l.derived(), r.derived());
+    }
+
+}  // namespace matrixf
+
+#endif  // MATRIX_EXPR_H
@@ -0,0 +1,323 @@
+/**
+ ******************************************************************************
+ * @file    matrix_fixed.h
+ * @brief   Fixed-point Q31 and Q15 matrices for cores without FPU.
+ *          arm_math q31/q15 kernels on Cortex-M, portable integer code with
+ *          the same saturation and truncation elsewhere.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Elements are fractions in [-1, 1), Q31 has 31 and Q15 has 15 fraction bits.
+ * Scale the signals so that sums and products stay in range, every result
+ * saturates to the nearest end instead of wrapping around.
+ *
+ * Usage:
+ *      matrixf::Matrixq31<3, 3> F(F_float);        // convert with saturation
+ *      x = F * x;                                  // 64 bit accumulation
+ *      y = x.scale(matrixf::qFromFloat<int32_t>(0.5f), 2);   // x*0.5*2^2
+ *      matrixf::Matrixf<3, 1> xf = x.toFloat();
+ *
+ * Products truncate the low bits like arm_mat_mult_q15, so host and target
+ * give the same numbers. The 64 bit sum of a Q31 product holds ±2, a sum
+ * beyond that wraps before it is saturated. Q31 multiply and scale run the portable code on
+ * Cortex-M too: arm_mat_mult_q31 wraps a sum out of range instead of
+ * saturating and arm_mat_scale_q31 drops one more low bit.
+ * There is no inverse, solve in float or keep the inverse precomputed.
+ */
+
+#ifndef MATRIX_FIXED_H
+#define MATRIX_FIXED_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "matrix.h"
+
+namespace matrixf {
+
+    // Range of one fixed-point format
+    template<typename T>
+    struct QFormat;
+
+    template<>
+    struct QFormat<int32_t> {
+        static constexpr uint32_t kFrac = 31;
+        static constexpr int64_t kMin = -2147483647LL - 1;
+        static constexpr int64_t kMax = 2147483647LL;
+    };
+
+    template<>
+    struct QFormat<int16_t> {
+        static constexpr uint32_t kFrac = 15;
+        static constexpr int64_t kMin = -32768;
+        static constexpr int64_t kMax = 32767;
+    };
+
+    // Clamp to the range of T
+    template<typename T>
+    inline T qSaturate(int64_t v) {
+        return (T) (v > QFormat<T>::kMax ? QFormat<T>::kMax : (v < QFormat<T>::kMin ? QFormat<T>::kMin : v));
+    }
+
+    // Round to the nearest fraction, saturated
+    template<typename T>
+    inline T qFromFloat(float v) {
+        float s = v * (float) (1LL << QFormat<T>::kFrac);
+        if (s >= (float) QFormat<T>::kMax) { return (T) QFormat<T>::kMax; }
+        if (s <= (float) QFormat<T>::kMin) { return (T) QFormat<T>::kMin; }
+        return (T) (s < 0 ? s - 0.5f : s + 0.5f);
+    }
+
+    template<typename T>
+    inline float qToFloat(T v) { return (float) v * (1.0f / (float) (1LL << QFormat<T>::kFrac)); }
+
+namespace backend {
+
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+    // arm matrix instance of a fixed-point buffer
+    template<typename T>
+    using QInstance = typename std::conditional<std::is_same<T, int32_t>::value,
+            arm_matrix_instance_q31, arm_matrix_instance_q15>::type;
+#endif
+
+    // dst = a + b, saturated
+    template<typename T>
+    inline void qadd(const T *a, const T *b, T *dst, uint32_t rows, uint32_t cols) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        QInstance<T> ma = {(uint16_t) rows, (uint16_t) cols, (T *) a};
+        QInstance<T> mb = {(uint16_t) rows, (uint16_t) cols, (T *) b};
+        QInstance<T> md = {(uint16_t) rows, (uint16_t) cols, dst};
+        if constexpr (std::is_same<T, int32_t>::value) {
+            arm_mat_add_q31(&ma, &mb, &md);
+        } else {
+            arm_mat_add_q15(&ma, &mb, &md);
+        }
+#else
+        for (uint32_t i = 0; i < rows * cols; i++) { dst[i] = qSaturate<T>((int64_t) a[i] + b[i]); }
+#endif
+    }
+
+    // dst = a - b, saturated
+    template<typename T>
+    inline void qsub(const T *a, const T *b, T *dst, uint32_t rows, uint32_t cols) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        QInstance<T> ma = {(uint16_t) rows, (uint16_t) cols, (T *) a};
+        QInstance<T> mb = {(uint16_t) rows, (uint16_t) cols, (T *) b};
+        QInstance<T> md = {(uint16_t) rows, (uint16_t) cols, dst};
+        if constexpr (std::is_same<T, int32_t>::value) {
+            arm_mat_sub_q31(&ma, &mb, &md);
+        } else {
+            arm_mat_sub_q15(&ma, &mb, &md);
+        }
+#else
+        for (uint32_t i = 0; i < rows * cols; i++) { dst[i] = qSaturate<T>((int64_t) a[i] - b[i]); }
+#endif
+    }
+
+    // dst = -a, saturated
+    template<typename T>
+    inline void qneg(const T *a, T *dst, uint32_t n) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        if constexpr (std::is_same<T, int32_t>::value) {
+            arm_negate_q31(a, dst, n);
+        } else {
+            arm_negate_q15(a, dst, n);
+        }
+#else
+        for (uint32_t i = 0; i < n; i++) { dst[i] = qSaturate<T>(-(int64_t) a[i]); }
+#endif
+    }
+
+    // dst = a * k * 2^shift, saturated
+    template<typename T>
+    inline void qscale(const T *a, T k, int32_t shift, T *dst, uint32_t rows, uint32_t cols) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        // Q31 on the loop below, arm_mat_scale_q31 truncates one bit more
+        if constexpr (std::is_same<T, int16_t>::value) {
+            QInstance<T> ma = {(uint16_t) rows, (uint16_t) cols, (T *) a};
+            QInstance<T> md = {(uint16_t) rows, (uint16_t) cols, dst};
+            arm_mat_scale_q15(&ma, k, shift, &md);
+            return;
+        }
+#endif
+        const int32_t s = (int32_t) QFormat<T>::kFrac - shift;
+        for (uint32_t i = 0; i < rows * cols; i++) {
+            int64_t p = (int64_t) a[i] * k;
+            dst[i] = qSaturate<T>(s >= 0 ? p >> s : p * ((int64_t) 1 << -s));
+        }
+    }
+
+    // dst(m*p) = a(m*n) * b(n*p), 64 bit accumulation, dst must not overlap a or b
+    template<uint32_t m, uint32_t n, uint32_t p, typename T>
+    inline void qmult(const T *a, const T *b, T *dst) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        // Q31 on the loop below, arm_mat_mult_q31 wraps instead of saturating
+        if constexpr (std::is_same<T, int16_t>::value) {
+            QInstance<T> ma = {(uint16_t) m, (uint16_t) n, (T *) a};
+            QInstance<T> mb = {(uint16_t) n, (uint16_t) p, (T *) b};
+            QInstance<T> md = {(uint16_t) m, (uint16_t) p, dst};
+            // Scratch for the transposed right operand
+            q15_t state[n * p];
+            arm_mat_mult_q15(&ma, &mb, &md, state);
+            return;
+        }
+#endif
+        for (uint32_t i = 0; i < m; i++) {
+            for (uint32_t j = 0; j < p; j++) {
+                int64_t acc = 0;
+                for (uint32_t k = 0; k < n; k++) { acc += (int64_t) a[i * n + k] * b[k * p + j]; }
+                dst[i * p + j] = qSaturate<T>(acc >> QFormat<T>::kFrac);
+            }
+        }
+    }
+
+    // dst(cols*rows) = a(rows*cols)^T, dst must not overlap a
+    template<typename T>
+    inline void qtrans(const T *a, T *dst, uint32_t rows, uint32_t cols) {
+#if MATRIX_BACKEND == MATRIX_BACKEND_CMSIS
+        QInstance<T> ma = {(uint16_t) rows, (uint16_t) cols, (T *) a};
+        QInstance<T> md = {(uint16_t) cols, (uint16_t) rows, dst};
+        if constexpr (std::is_same<T, int32_t>::value) {
+            arm_mat_trans_q31(&ma, &md);
+        } else {
+            arm_mat_trans_q15(&ma, &md);
+        }
+#else
+        for (uint32_t i = 0; i < rows; i++) {
+            for (uint32_t j = 0; j < cols; j++) { dst[j * rows + i] = a[i * cols + j]; }
+        }
+#endif
+    }
+
+}  // namespace backend
+
+// Fixed-point matrix, T is int32_t for Q31 or int16_t for Q15
+    template<typename T, uint32_t _rows, uint32_t _cols>
+    class MatrixQ {
+    protected:
+        T data_[_rows * _cols];
+
+    public:
+        static constexpr uint32_t kRows = _rows;
+        static constexpr uint32_t kCols = _cols;
+
+        // Constructor without input data
+        MatrixQ() = default;
+
+        explicit MatrixQ(const T *data) { memcpy(data_, data, sizeof(data_)); }
+
+        // Convert from float, saturated to [-1, 1)
+        explicit MatrixQ(const Matrixf<_rows, _cols> &mat) {
+            for (uint32_t i = 0; i < _rows * _cols; i++) { data_[i] = qFromFloat<T>(mat.data()[i]); }
+        }
+
+        Matrixf<_rows, _cols> toFloat() const {
+            Matrixf<_rows, _cols> res;
+            for (uint32_t i = 0; i < _rows * _cols; i++) { res.data()[i] = qToFloat(data_[i]); }
+            return res;
+        }
+
+        /*  Operators about elements    */
+        uint32_t rows() const { return _rows; }
+
+        uint32_t cols() const { return _cols; }
+
+        uint32_t size() const { return _rows * _cols; }
+
+        T *data() { return data_; }
+
+        const T *data() const { return data_; }
+
+        T &operator()(const uint32_t &row, const uint32_t &col) { return data_[row * _cols + col]; }
+
+        const T &operator()(const uint32_t &row, const uint32_t &col) const { return data_[row * _cols + col]; }
+
+        MatrixQ<T, 1, _cols> row(const uint32_t &row) const { return MatrixQ<T, 1, _cols>(data_ + row * _cols); }
+
+        MatrixQ<T, _rows, 1> col(const uint32_t &col) const {
+            MatrixQ<T, _rows, 1> res;
+            for (uint32_t i = 0; i < _rows; i++) { res(i, 0) = data_[i * _cols + col]; }
+            return res;
+        }
+
+        /*Operators about operations, all saturate*/
+        MatrixQ &operator+=(const MatrixQ &mat) {
+            backend::qadd(data_, mat.data_, data_, _rows, _cols);
+            return *this;
+        }
+
+        MatrixQ &operator-=(const MatrixQ &mat) {
+            backend::qsub(data_, mat.data_, data_, _rows, _cols);
+            return *this;
+        }
+
+        // Multiply by a fraction
+        MatrixQ &operator*=(const T &val) {
+            backend::qscale(data_, val, 0, data_, _rows, _cols);
+            return *this;
+        }
+
+        MatrixQ &operator*=(const MatrixQ<T, _cols, _cols> &mat) { return *this = *this * mat; }
+
+        MatrixQ operator+(const MatrixQ &mat) const {
+            MatrixQ res;
+            backend::qadd(data_, mat.data_, res.data_, _rows, _cols);
+            return res;
+        }
+
+        MatrixQ operator-(const MatrixQ &mat) const {
+            MatrixQ res;
+            backend::qsub(data_, mat.data_, res.data_, _rows, _cols);
+            return res;
+        }
+
+        MatrixQ operator-() const {
+            MatrixQ res;
+            backend::qneg(data_, res.data_, _rows * _cols);
+            return res;
+        }
+
+        // Multiply by a fraction
+        MatrixQ operator*(const T &val) const {
+            MatrixQ res;
+            backend::qscale(data_, val, 0, res.data_, _rows, _cols);
+            return res;
+        }
+
+        // this * frac * 2^shift, a shift lets the scale factor exceed 1
+        MatrixQ scale(const T &frac, int32_t shift) const {
+            MatrixQ res;
+            backend::qscale(data_, frac, shift, res.data_, _rows, _cols);
+            return res;
+        }
+
+        template<uint32_t cols>
+        MatrixQ<T, _rows, cols> operator*(const MatrixQ<T, _cols, cols> &mat) const {
+            MatrixQ<T, _rows, cols> res;
+            backend::qmult<_rows, _cols, cols>(data_, mat.data(), res.data());
+            return res;
+        }
+
+        MatrixQ<T, _cols, _rows> transpose() const {
+            MatrixQ<T, _cols, _rows> res;
+            backend::qtrans(data_, res.data(), _rows, _cols);
+            return res;
+        }
+    };
+
+    template<uint32_t _rows, uint32_t _cols>
+    using Matrixq31 = MatrixQ<int32_t, _rows, _cols>;
+
+    template<uint32_t _rows, uint32_t _cols>
+    using Matrixq15 = MatrixQ<int16_t, _rows, _cols>;
+
+}  // namespace matrixf
+
+#endif  // MATRIX_FIXED_H
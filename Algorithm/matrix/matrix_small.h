@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * @file    matrix_small.h
+ * @brief   Fully unrolled kernels of matrix.h for small sizes.
+ *          Every loop is expanded at compile time, so a 6x6 multiply is
+ *          straight-line code without call overhead or size checks.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Matrixf switches to these kernels when both dimensions of every operand
+ * are not bigger than MATRIX_SMALL_SIZE, larger sizes go to matrix_backend.h.
+ */
+
+#ifndef MATRIX_SMALL_H
+#define MATRIX_SMALL_H
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#ifndef MATRIX_SMALL_SIZE
+#define MATRIX_SMALL_SIZE 6
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MATRIX_INLINE __attribute__((always_inline)) inline
+#define MATRIX_LAMBDA_INLINE __attribute__((always_inline))
+#else
+#define MATRIX_INLINE inline
+#define MATRIX_LAMBDA_INLINE
+#endif
+
+// True while the compiler evaluates a constant expression
+#if defined(__GNUC__) || defined(__clang__)
+#define MATRIX_CONSTEVAL() __builtin_is_constant_evaluated()
+#else
+#define MATRIX_CONSTEVAL() false
+#endif
+
+namespace matrixf {
+namespace small {
+
+    template<uint32_t _rows, uint32_t _cols>
+    constexpr bool kEnable = (_rows <= MATRIX_SMALL_SIZE) && (_cols <= MATRIX_SMALL_SIZE);
+
+    template<typename F, uint32_t... I>
+    MATRIX_INLINE constexpr void unrollImpl(F &&f, std::integer_sequence<uint32_t, I...>) {
+        (f(std::integral_constant<uint32_t, I>{}), ...);
+    }
+
+    // Call f(0), f(1) ... f(N-1), indexes are integral constants
+    template<uint32_t N, typename F>
+    MATRIX_INLINE constexpr void unroll(F &&f) {
+        unrollImpl(f, std::make_integer_sequence<uint32_t, N>{});
+    }
+
+    // dst = a + b
+    template<uint32_t N>
+    MATRIX_INLINE constexpr void add(const float *a, const float *b, float *dst) {
+        unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { dst[i] = a[i] + b[i]; });
+    }
+
+    // dst = a - b
+    template<uint32_t N>
+    MATRIX_INLINE constexpr void sub(const float *a, const float *b, float *dst) {
+        unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { dst[i] = a[i] - b[i]; });
+    }
+
+    // dst = a * k
+    template<uint32_t N>
+    MATRIX_INLINE constexpr void scale(const float *a, float k, float *dst) {
+        unroll<N>([&](auto i) MATRIX_LAMBDA_INLINE { dst[i] = a[i] * k; });
+    }
+
+    // dst(M*P) = a(M*N) * b(N*P), dst must not overlap a or b
+    template<uint32_t M, uint32_t N, uint32_t P>
+    MATRIX_INLINE constexpr void mult(const float *a, const float *b, float *dst) {
+        // Row i of dst accumulates a(i,k) * row k of b, which the compiler can pack into SIMD lanes
+        unroll<M>([&](auto i) MATRIX_LAMBDA_INLINE {
+            float row[P] = {};
+            unroll<P>([&](auto j) MATRIX_LAMBDA_INLINE { row[j] = a[i * N] * b[j]; });
+            unroll<N - 1>([&](auto k) MATRIX_LAMBDA_INLINE {
+                unroll<P>([&](auto j) MATRIX_LAMBDA_INLINE { row[j] += a[i * N + k + 1] * b[(k + 1) * P + j]; });
+            });
+            unroll<P>([&](auto j) MATRIX_LAMBDA_INLINE { dst[i * P + j] = row[j]; });
+        });
+    }
+
+    /**
+     * dst(N*N) = a(N*N)^-1, a is destroyed.
+     * Closed form up to 3x3, unrolled Gauss-Jordan with partial pivoting above.
+     * Return 0 on success, 0x01 if a is singular.
+     */
+    template<uint32_t N>
+    MATRIX_INLINE constexpr uint8_t inverse(float *a, float *dst) {
+        if constexpr (N == 1) {
+            if (a[0] == 0.0f) { return 0x01; }
+            dst[0] = 1.0f / a[0];
+            return 0;
+        } else if constexpr (N == 2) {
+            float det = a[0] * a[3] - a[1] * a[2];
+            if (det == 0.0f) { return 0x01; }
+            float inv = 1.0f / det;
+            dst[0] = a[3] * inv;
+            dst[1] = -a[1] * inv;
+            dst[2] = -a[2] * inv;
+            dst[3] = a[0] * inv;
+            return 0;
+        } else if constexpr (N == 3) {
+            float c00 = a[4] * a[8] - a[5] * a[7];
+            float c01 = a[5] * a[6] - a[3] * a[8];
+            float c02 = a[3] * a[7] - a[4] * a[6];
+            float det = a[0] * c00 + a[1] * c01 + a[2] * c02;
+            if (det == 0.0f) { return 0x01; }
+            float inv = 1.0f / det;
+            dst[0] = c00 * inv;
+            dst[1] = (a[2] * a[7] - a[1] * a[8]) * inv;
+            dst[2] = (a[1] * a[5] - a[2] * a[4]) * inv;
+            dst[3] = c01 * inv;
+            dst[4] = (a[0] * a[8] - a[2] * a[6]) * inv;
+            dst[5] = (a[2] * a[3] - a[0] * a[5]) * inv;
+            dst[6] = c02 * inv;
+            dst[7] = (a[1] * a[6] - a[0] * a[7]) * inv;
+            dst[8] = (a[0] * a[4] - a[1] * a[3]) * inv;
+            return 0;
+        } else {
+            uint8_t singular = 0;
+            unroll<N * N>([&](auto i) MATRIX_LAMBDA_INLINE { dst[i] = (i % (N + 1) == 0) ? 1.0f : 0.0f; });
+            unroll<N>([&](auto c) MATRIX_LAMBDA_INLINE {
+                constexpr uint32_t col = decltype(c)::value;
+                if (singular) { return; }
+                uint32_t pivot = c;
+                float pmax = a[c * N + c] < 0 ? -a[c * N + c] : a[c * N + c];
+                unroll<N>([&](auto r) MATRIX_LAMBDA_INLINE {
+                    if constexpr (decltype(r)::value > col) {
+                        float v = a[r * N + c] < 0 ? -a[r * N + c] : a[r * N + c];
+                        if (v > pmax) {
+                            pmax = v;
+                            pivot = r;
+                        }
+                    }
+                });
+                if (pmax == 0.0f) {
+                    singular = 0x01;
+                    return;
+                }
+                if (pivot != c) {
+                    unroll<N>([&](auto k) MATRIX_LAMBDA_INLINE {
+                        float t = a[c * N + k];
+                        a[c * N + k] = a[pivot * N + k];
+                        a[pivot * N + k] = t;
+                        t = dst[c * N + k];
+                        dst[c * N + k] = dst[pivot * N + k];
+                        dst[pivot * N + k] = t;
+                    });
+                }
+                float inv = 1.0f / a[c * N + c];
+                unroll<N>([&](auto k) MATRIX_LAMBDA_INLINE {
+                    a[c * N + k] *= inv;
+                    dst[c * N + k] *= inv;
+                });
+                unroll<N>([&](auto r) MATRIX_LAMBDA_INLINE {
+                    if constexpr (decltype(r)::value != col) {
+                        float f = a[r * N + c];
+                        unroll<N>([&](auto k) MATRIX_LAMBDA_INLINE {
+                            a[r * N + k] -= f * a[c * N + k];
+                            dst[r * N + k] -= f * dst[c * N + k];
+                        });
+                    }
+                });
+            });
+            return singular;
+        }
+    }
+
+}  // namespace small
+}  // namespace matrixf
+
+#endif  // MATRIX_SMALL_H
@@ -0,0 +1,272 @@
+/**
+ ******************************************************************************
+ * @file    matrix_sym.h
+ * @brief   Packed symmetric matrix for covariances.
+ *          Only the upper triangle is stored, kernels write the upper
+ *          triangle only, so the result is symmetric by construction.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Storage of the upper triangle row by row, N(N+1)/2 elements
+ * [a11,a12,a13,a22,a23,a33]
+ *
+ * Dense operands of the kernels can be any type with operator()(i,j), e.g.
+ * Matrixf, an expression of matrix_expr.h or an Eigen matrix, so the same
+ * type serves the Eigen based kalman filters and Matrixf users.
+ *
+ * Cost against dense Matrixf / Eigen of the same size:
+ *      congruence  F*P*F^T     N^3 + N^2(N+1)/2 instead of 2N^3 multiplies
+ *      rankUpdate  P+a*U*U^T   half of the multiplies
+ *      +=, -=, *=              half of the operations
+ *
+ * congruence() and mult() also take a Pattern of the dense operand, a type
+ * with static constexpr uint8_t at(i, j) returning kZero, kOne or kAny:
+ *      struct PatternF {
+ *          static constexpr uint8_t at(uint32_t i, uint32_t j) { return i < 4 ? kAny : i == j; }
+ *      };
+ *      P = P.congruence<6>(F, PatternF());
+ * The loops are unrolled and skip the structural zeros and the multiplies
+ * by one. The remaining terms are summed in the same order as the plain
+ * kernels, so the results are the same to the bit as long as the compiler
+ * does not fuse a*b+c in one of them only (-ffp-contract=off on FPUs with
+ * fused multiply-add).
+ */
+
+#ifndef MATRIX_SYM_H
+#define MATRIX_SYM_H
+
+#include <cstdint>
+
+#include "matrix_small.h"
+
+namespace matrixf {
+
+// Element classes of a Pattern
+    enum : uint8_t {
+        kZero = 0,
+        kOne = 1,
+        kAny = 2
+    };
+
+    template<typename Scalar, uint32_t _size>
+    class SymMatrix {
+    protected:
+        Scalar data_[_size * (_size + 1) / 2];
+
+    public:
+        static constexpr uint32_t kSize = _size;
+        static constexpr uint32_t kPacked = _size * (_size + 1) / 2;
+
+        // Offset of element (i,j) with i <= j
+        static constexpr uint32_t index(uint32_t i, uint32_t j) {
+            return i * _size - i * (i + 1) / 2 + j;
+        }
+
+        // Zero matrix
+        SymMatrix() : data_{} {}
+
+        uint32_t rows() const { return _size; }
+
+        uint32_t cols() const { return _size; }
+
+        // Number of stored elements
+        uint32_t size() const { return kPacked; }
+
+        Scalar *data() { return data_; }
+
+        const Scalar *data() const { return data_; }
+
+        // (i,j) and (j,i) are the same element
+        Scalar &operator()(uint32_t row, uint32_t col) {
+            return row <= col ? data_[index(row, col)] : data_[index(col, row)];
+        }
+
+        const Scalar &operator()(uint32_t row, uint32_t col) const {
+            return row <= col ? data_[index(row, col)] : data_[index(col, row)];
+        }
+
+        void setZero() { fill(Scalar(0)); }
+
+        void fill(const Scalar &val) {
+            for (uint32_t i = 0; i < kPacked; i++) { data_[i] = val; }
+        }
+
+        // val on the diagonal, zero elsewhere
+        void setIdentity(const Scalar &val = Scalar(1)) {
+            setZero();
+            for (uint32_t i = 0; i < _size; i++) { data_[index(i, i)] = val; }
+        }
+
+        // Take the upper triangle of a dense matrix
+        template<typename M>
+        void fromDense(const M &m) {
+            for (uint32_t i = 0; i < _size; i++) {
+                for (uint32_t j = i; j < _size; j++) { data_[index(i, j)] = m(i, j); }
+            }
+        }
+
+        // Write both triangles into a dense matrix
+        template<typename M>
+        void toDense(M &m) const {
+            for (uint32_t i = 0; i < _size; i++) {
+                m(i, i) = data_[index(i, i)];
+                for (uint32_t j = i + 1; j < _size; j++) {
+                    m(i, j) = data_[index(i, j)];
+                    m(j, i) = data_[index(i, j)];
+                }
+            }
+        }
+
+        SymMatrix &operator+=(const SymMatrix &mat) {
+            for (uint32_t i = 0; i < kPacked; i++) { data_[i] += mat.data_[i]; }
+            return *this;
+        }
+
+        SymMatrix &operator-=(const SymMatrix &mat) {
+            for (uint32_t i = 0; i < kPacked; i++) { data_[i] -= mat.data_[i]; }
+            return *this;
+        }
+
+        SymMatrix &operator*=(const Scalar &val) {
+            for (uint32_t i = 0; i < kPacked; i++) { data_[i] *= val; }
+            return *this;
+        }
+
+        // Add the upper triangle of a dense matrix which is known to be symmetric
+        template<typename M>
+        SymMatrix &addDense(const M &m) {
+            for (uint32_t i = 0; i < _size; i++) {
+                for (uint32_t j = i; j < _size; j++) { data_[index(i, j)] += m(i, j); }
+            }
+            return *this;
+        }
+
+        /**
+         * F*P*F^T, F is _rows x _size.
+         * F*P is formed once, then only the upper triangle of (F*P)*F^T.
+         */
+        template<uint32_t _rows, typename M>
+        SymMatrix<Scalar, _rows> congruence(const M &f) const {
+            Scalar fp[_rows][_size];
+            SymMatrix<Scalar, _rows> res;
+            for (uint32_t i = 0; i < _rows; i++) {
+                for (uint32_t j = 0; j < _size; j++) {
+                    Scalar acc = Scalar(0);
+                    for (uint32_t k = 0; k < _size; k++) { acc += f(i, k) * (*this)(k, j); }
+                    fp[i][j] = acc;
+                }
+            }
+            for (uint32_t i = 0; i < _rows; i++) {
+                for (uint32_t j = i; j < _rows; j++) {
+                    Scalar acc = Scalar(0);
+                    for (uint32_t k = 0; k < _size; k++) { acc += fp[i][k] * f(j, k); }
+                    res(i, j) = acc;
+                }
+            }
+            return res;
+        }
+
+        // F*P*F^T skipping the zeros and ones of F given by Pattern
+        template<uint32_t _rows, typename M, typename Pattern>
+        SymMatrix<Scalar, _rows> congruence(const M &f, Pattern) const {
+            Scalar fp[_rows][_size];
+            SymMatrix<Scalar, _rows> res;
+            small::unroll<_rows>([&](auto i) MATRIX_LAMBDA_INLINE {
+                small::unroll<_size>([&](auto j) MATRIX_LAMBDA_INLINE {
+                    Scalar acc = Scalar(0);
+                    small::unroll<_size>([&](auto k) MATRIX_LAMBDA_INLINE {
+                        if constexpr (Pattern::at(i, k) == kOne) {
+                            acc += (*this)(k(), j());
+                        } else if constexpr (Pattern::at(i, k) == kAny) {
+                            acc += f(i(), k()) * (*this)(k(), j());
+                        }
+                    });
+                    fp[i][j] = acc;
+                });
+            });
+            small::unroll<_rows>([&](auto i) MATRIX_LAMBDA_INLINE {
+                small::unroll<_rows>([&](auto j) MATRIX_LAMBDA_INLINE {
+                    if constexpr (j >= i) {
+                        Scalar acc = Scalar(0);
+                        small::unroll<_size>([&](auto k) MATRIX_LAMBDA_INLINE {
+                            if constexpr (Pattern::at(j, k) == kOne) {
+                                acc += fp[i][k];
+                            } else if constexpr (Pattern::at(j, k) == kAny) {
+                                acc += fp[i][k] * f(j(), k());
+                            }
+                        });
+                        res(i(), j()) = acc;
+                    }
+                });
+            });
+            return res;
+        }
+
+        // P += alpha*U*U^T, U is _size x _rank
+        template<uint32_t _rank, typename M>
+        SymMatrix &rankUpdate(const M &u, const Scalar &alpha) {
+            for (uint32_t i = 0; i < _size; i++) {
+                for (uint32_t j = i; j < _size; j++) {
+                    Scalar acc = Scalar(0);
+                    for (uint32_t k = 0; k < _rank; k++) { acc += u(i, k) * u(j, k); }
+                    data_[index(i, j)] += alpha * acc;
+                }
+            }
+            return *this;
+        }
+
+        // out = P*B, B is _size x _cols
+        template<uint32_t _cols, typename M, typename Out>
+        void mult(const M &b, Out &out) const {
+            for (uint32_t i = 0; i < _size; i++) {
+                for (uint32_t j = 0; j < _cols; j++) {
+                    Scalar acc = Scalar(0);
+                    for (uint32_t k = 0; k < _size; k++) { acc += (*this)(i, k) * b(k, j); }
+                    out(i, j) = acc;
+                }
+            }
+        }
+
+        // out = P*B skipping the zeros and ones of B given by Pattern
+        template<uint32_t _cols, typename M, typename Out, typename Pattern>
+        void mult(const M &b, Out &out, Pattern) const {
+            small::unroll<_size>([&](auto i) MATRIX_LAMBDA_INLINE {
+                small::unroll<_cols>([&](auto j) MATRIX_LAMBDA_INLINE {
+                    Scalar acc = Scalar(0);
+                    small::unroll<_size>([&](auto k) MATRIX_LAMBDA_INLINE {
+                        if constexpr (Pattern::at(k, j) == kOne) {
+                            acc += (*this)(i(), k());
+                        } else if constexpr (Pattern::at(k, j) == kAny) {
+                            acc += (*this)(i(), k()) * b(k(), j());
+                        }
+                    });
+                    out(i(), j()) = acc;
+                });
+            });
+        }
+
+        // v^T*P*v, v is a _size x 1 vector
+        template<typename V>
+        Scalar quadForm(const V &v) const {
+            Scalar res = Scalar(0);
+            for (uint32_t i = 0; i < _size; i++) {
+                Scalar acc = data_[index(i, i)] * v(i, 0);
+                for (uint32_t j = i + 1; j < _size; j++) { acc += Scalar(2) * data_[index(i, j)] * v(j, 0); }
+                res += v(i, 0) * acc;
+            }
+            return res;
+        }
+    };
+
+    template<uint32_t _size>
+    using SymMatrixf = SymMatrix<float, _size>;
+
+}  // namespace matrixf
+
+#endif  // MATRIX_SYM_H
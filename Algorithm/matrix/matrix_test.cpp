@@ -0,0 +1,397 @@
+#include "matrix.h"
+#include "matrix_sym.h"
+#include "matrix_batch.h"
+#include "matrix_fixed.h"
+#include "quaternion.h"
+#include "dual.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+static uint32_t failed = 0;
+
+// Model matrices evaluated by the compiler
+constexpr float kDt = 0.01f;
+constexpr float kDiag[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+constexpr matrixf::Matrixf<4, 4> kF = matrixf::Eye<4, 4>() + matrixf::Ones<4, 4>() * kDt;
+constexpr matrixf::Matrixf<4, 4> kQ = matrixf::Diag<4, 4>(matrixf::Matrixf<4, 1>(kDiag)) * kDt;
+constexpr matrixf::Matrixf<4, 4> kP = kF * kQ * kF.transpose() + matrixf::Zeros<4, 4>();
+static_assert(kF(1, 1) == 1.0f + kDt && kF(1, 2) == kDt && kQ(3, 3) == 4.0f * kDt && kQ(2, 3) == 0.0f,
+              "constexpr factories");
+
+// Quaternion rows full, bias rows identity, like the F of the AHRS filter
+struct PatternBias {
+    static constexpr uint8_t at(uint32_t i, uint32_t j) {
+        return i < 4 ? matrixf::kAny : (i == j ? matrixf::kOne : matrixf::kZero);
+    }
+};
+
+static void check(const char *name, float err, float tol = 1e-5f) {
+    bool ok = err <= tol;
+    if (!ok) { failed++; }
+    printf("%-32s %s (err %.3g)\n", name, ok ? "OK  " : "FAIL", err);
+}
+
+template<uint32_t R, uint32_t C>
+static void fill(matrixf::Matrixf<R, C> &m, float seed) {
+    for (uint32_t i = 0; i < R; i++) {
+        for (uint32_t j = 0; j < C; j++) {
+            m(i, j) = std::sin(seed + 0.37f * (float) (i * C + j)) + (i == j ? 2.0f : 0.0f);
+        }
+    }
+}
+
+template<uint32_t R, uint32_t C>
+static float maxDiff(const matrixf::Matrixf<R, C> &a, const matrixf::Matrixf<R, C> &b) {
+    float err = 0;
+    for (uint32_t i = 0; i < R; i++) {
+        for (uint32_t j = 0; j < C; j++) {
+            err = std::fmax(err, std::fabs(a(i, j) - b(i, j)));
+        }
+    }
+    return err;
+}
+
+template<uint32_t M, uint32_t N, uint32_t P>
+static void testMult() {
+    matrixf::Matrixf<M, N> a;
+    matrixf::Matrixf<N, P> b;
+    matrixf::Matrixf<M, P> ref;
+    fill(a, 0.1f);
+    fill(b, 0.7f);
+    for (uint32_t i = 0; i < M; i++) {
+        for (uint32_t j = 0; j < P; j++) {
+            double acc = 0;
+            for (uint32_t k = 0; k < N; k++) { acc += (double) a(i, k) * b(k, j); }
+            ref(i, j) = (float) acc;
+        }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "mult %ux%u*%ux%u", (unsigned) M, (unsigned) N, (unsigned) N, (unsigned) P);
+    check(name, maxDiff(matrixf::Matrixf<M, P>(a * b), ref));
+}
+
+template<uint32_t N>
+static void testInverse() {
+    matrixf::Matrixf<N, N> a;
+    fill(a, 0.3f);
+    char name[32];
+    snprintf(name, sizeof(name), "inverse %ux%u", (unsigned) N, (unsigned) N);
+    check(name, maxDiff(matrixf::Matrixf<N, N>(a * a.inverse()), matrixf::Eye<N, N>()), 1e-4f);
+}
+
+int main() {
+    printf("Matrix backend id: %d\n", MATRIX_BACKEND);
+
+    testMult<3, 3, 3>();
+    testMult<6, 6, 6>();
+    testMult<4, 9, 13>();
+    testMult<12, 7, 1>();
+    testInverse<1>();
+    testInverse<3>();
+    testInverse<6>();
+    testInverse<12>();
+
+    matrixf::Matrixf<5, 7> a, b;
+    fill(a, 0.2f);
+    fill(b, 1.3f);
+    matrixf::Matrixf<5, 7> sum = a + b, diff = a - b, scaled = a * 2.5f;
+    float err = 0;
+    for (uint32_t i = 0; i < 5; i++) {
+        for (uint32_t j = 0; j < 7; j++) {
+            err = std::fmax(err, std::fabs(sum(i, j) - (a(i, j) + b(i, j))));
+            err = std::fmax(err, std::fabs(diff(i, j) - (a(i, j) - b(i, j))));
+            err = std::fmax(err, std::fabs(scaled(i, j) - a(i, j) * 2.5f));
+        }
+    }
+    check("add/sub/scale 5x7", err);
+    check("transpose 5x7", maxDiff(a.transpose().transpose(), a));
+
+    float fro = 0;
+    for (uint32_t i = 0; i < 5; i++) {
+        for (uint32_t j = 0; j < 7; j++) { fro += a(i, j) * a(i, j); }
+    }
+    check("norm 5x7", std::fabs(a.norm() - std::sqrt(fro)));
+
+    matrixf::Matrixf<3, 3> m;
+    fill(m, 0.5f);
+    matrixf::Matrixf<3, 3> mm = m * m;
+    m *= m;
+    check("in-place multiply", maxDiff(m, mm));
+
+    // Kalman covariance predict, P appears on both sides
+    matrixf::Matrixf<6, 6> F, P, Q, FP, Pref;
+    fill(F, 0.4f);
+    fill(P, 0.8f);
+    fill(Q, 1.1f);
+    FP = F * P;
+    Pref = FP * F.transpose();
+    Pref += Q;
+    P = F * P * F.transpose() + Q;
+    check("P = F*P*F^T + Q", maxDiff(P, Pref), 1e-4f);
+
+    matrixf::Matrixf<6, 6> At = F.transpose();
+    F = F.transpose();
+    check("aliased transpose", maxDiff(F, At));
+    F = (F + Q) * 0.5f - Q / 2.0f;
+    check("fused element-wise", maxDiff(F, matrixf::Matrixf<6, 6>(At * 0.5f)), 1e-6f);
+
+    matrixf::Matrixf<4, 4> rF = matrixf::Eye<4, 4>(), rQ;
+    rF += matrixf::Ones<4, 4>() * kDt;
+    rQ = matrixf::Diag<4, 4>(matrixf::Matrixf<4, 1>(kDiag)) * kDt;
+    check("constexpr F*Q*F^T", maxDiff(kP, matrixf::Matrixf<4, 4>(rF * rQ * rF.transpose())), 1e-6f);
+
+    // In-place operations on a scratch, P appears on both sides
+    matrixf::Scratch<72> scratch;
+    matrixf::Matrixf<6, 6> Ps, Fs, Ss;
+    fill(Ps, 0.8f);
+    fill(Fs, 0.4f);
+    Pref = Fs * Ps * Fs.transpose();
+    Ps.leftMult(Fs, scratch).assign(Ps * Fs.transpose(), scratch);
+    err = maxDiff(Ps, Pref);
+    Pref = Ps * Fs;
+    Ps.mult(Fs, scratch);
+    err = std::fmax(err, maxDiff(Ps, Pref));
+    Pref = Ps.transpose();
+    err = std::fmax(err, maxDiff(Ps.transposeInPlace(), Pref));
+    Ss = Fs;
+    uint8_t serr = Fs.solveInPlace(Ss, scratch);
+    err = std::fmax(err + serr, maxDiff(Ss, matrixf::Eye<6, 6>()));
+    check("scratch mult/transpose/solve", err, 1e-4f);
+
+    // Views write in place, overlapping blocks go through a temporary
+    matrixf::Matrixf<6, 6> V, Vref;
+    fill(V, 0.3f);
+    Vref = V;
+    V.block<3, 3>(1, 2) = V.block<3, 3>(0, 1) * 2.0f;
+    V.block<3, 3>(0, 0) = V.block<3, 3>(1, 1).transpose();
+    V.diagonal() += Vref.col(5);
+    V.row(5) = V.col(4).transpose();
+    V.col(3) = V * Vref.col(0);
+    for (uint32_t i = 0; i < 3; i++) {
+        for (uint32_t j = 0; j < 3; j++) { Pref(1 + i, 2 + j) = Vref(i, 1 + j) * 2.0f; }
+    }
+    for (uint32_t i = 0; i < 6; i++) {
+        for (uint32_t j = 0; j < 6; j++) {
+            if (!(i >= 1 && i < 4 && j >= 2 && j < 5)) { Pref(i, j) = Vref(i, j); }
+        }
+    }
+    At = Pref;
+    for (uint32_t i = 0; i < 3; i++) {
+        for (uint32_t j = 0; j < 3; j++) { At(i, j) = Pref(1 + j, 1 + i); }
+    }
+    for (uint32_t i = 0; i < 6; i++) { At(i, i) += Vref(i, 5); }
+    Pref = At;
+    for (uint32_t j = 0; j < 6; j++) { At(5, j) = Pref(j, 4); }
+    Pref = At;
+    At.setCol(3, Pref * Vref.col(0));
+    check("block/row/col/diagonal views", maxDiff(V, At), 1e-4f);
+    check("storage is the data only", (float) (sizeof(matrixf::Matrixf<3, 3>) != 9 * sizeof(float) ||
+                                               sizeof(matrixf::Matrixf<6, 6>) != 36 * sizeof(float)));
+
+    // Packed symmetric covariance against the dense path
+    matrixf::Matrixf<6, 6> G, S, Sd;
+    matrixf::Matrixf<6, 2> U;
+    fill(G, 0.6f);
+    fill(S, 0.9f);
+    fill(U, 1.7f);
+    S = S * S.transpose();
+    matrixf::SymMatrixf<6> Sp;
+    Sp.fromDense(S);
+    Sp = Sp.congruence<6>(G);
+    Sp.rankUpdate<2>(U, 0.5f);
+    Sp.toDense(Sd);
+    check("sym F*P*F^T + a*U*U^T", maxDiff(Sd, matrixf::Matrixf<6, 6>(G * S * G.transpose() + U * U.transpose() * 0.5f)),
+          1e-3f);
+    // Same with the zero and identity rows skipped
+    for (uint32_t j = 0; j < 6; j++) {
+        G(4, j) = j == 4 ? 1.0f : 0.0f;
+        G(5, j) = j == 5 ? 1.0f : 0.0f;
+    }
+    U(4, 0) = U(4, 1) = U(5, 0) = U(5, 1) = 0.0f;
+    matrixf::Matrixf<6, 6> Sg;
+    matrixf::Matrixf<6, 2> Ug;
+    Sp.fromDense(S);
+    Sp.congruence<6>(G).toDense(Sd);
+    Sp.congruence<6>(G, PatternBias()).toDense(Sg);
+    Sp.mult<2>(U, Ug, PatternBias());
+    check("sym pattern congruence/mult", maxDiff(Sg, Sd) + maxDiff(Ug, matrixf::Matrixf<6, 2>(S * U)), 1e-4f);
+
+    // Factorizations against the explicit inverse
+    matrixf::Matrixf<6, 2> rhs;
+    fill(rhs, 2.1f);
+    matrixf::Matrixf<6, 2> xinv = S.inverse() * rhs;
+    check("lu solve", maxDiff(S.lu().solve(rhs), xinv), 1e-3f);
+    check("cholesky solve", maxDiff(S.cholesky().solve(rhs), xinv), 1e-3f);
+    check("ldlt solve", maxDiff(S.ldlt().solve(rhs), xinv), 1e-3f);
+    check("qr solve", maxDiff(S.qr().solve(rhs), xinv), 1e-3f);
+    float det = S.lu().determinant();
+    check("lu determinant", std::fabs(S.cholesky().determinant() / det - 1.0f) +
+                            std::fabs(S.ldlt().determinant() / det - 1.0f) +
+                            std::fabs(S.qr().determinant() / det - 1.0f), 1e-3f);
+    matrixf::Matrixf<8, 3> tall;
+    matrixf::Matrixf<3, 1> sol;
+    fill(tall, 0.2f);
+    fill(sol, 0.4f);
+    check("qr least squares", maxDiff(tall.qr().solve(tall * sol), sol), 1e-4f);
+
+    // Symmetric eigensolver, distinct and repeated eigenvalues, and SVD reconstruction
+    matrixf::Matrixf<3, 3> E, ER, EV, E2;
+    fill(E, 0.5f);
+    E = E + E.transpose();
+    auto eig = E.symEig();
+    EV = eig.eigenvectors();
+    check("sym eig3 A*V = V*D", maxDiff(matrixf::Matrixf<3, 3>(E * EV),
+                                        matrixf::Matrixf<3, 3>(EV * matrixf::Diag<3, 3>(eig.eigenvalues()))), 1e-5f);
+    check("sym eig3 V^T*V = I", maxDiff(matrixf::Matrixf<3, 3>(EV.transpose() * EV), matrixf::Eye<3, 3>()), 1e-6f);
+    const float rep[3] = {1.0f, 1.0f, 3.0f};
+    ER = vector3f::Quaternionf::exp(sol).toDCM();
+    E2 = ER * matrixf::Diag<3, 3>(matrixf::Matrixf<3, 1>(rep)) * ER.transpose();
+    auto eig2 = E2.symEig();
+    EV = eig2.eigenvectors();
+    check("sym eig3 repeated", maxDiff(eig2.eigenvalues(), matrixf::Matrixf<3, 1>(rep)) +
+                               maxDiff(matrixf::Matrixf<3, 3>(EV * matrixf::Diag<3, 3>(eig2.eigenvalues()) *
+                                                              EV.transpose()), E2), 1e-5f);
+    matrixf::Matrixf<6, 4> W;
+    fill(W, 1.3f);
+    auto svd = W.svd();
+    matrixf::Matrixf<4, 1> sv = svd.singularValues();
+    check("svd U*S*V^T", maxDiff(matrixf::Matrixf<6, 4>(svd.matrixU() * matrixf::Diag<4, 4>(sv) *
+                                                        svd.matrixV().transpose()), W) +
+                         maxDiff(matrixf::Matrixf<4, 4>(svd.matrixV().transpose() * svd.matrixV()),
+                                 matrixf::Eye<4, 4>()) + (float) (svd.status() != 0 || sv(0, 0) < sv(3, 0)), 1e-5f);
+    check("svd least squares", maxDiff(tall.svd().solve(tall * sol), sol), 1e-4f);
+
+    // expm of a rotation generator against the quaternion, small and scaled-down norms
+    matrixf::Matrixf<3, 3> Er = vector3f::hat(sol * 0.1f).expm();
+    check("expm small", maxDiff(Er, vector3f::Quaternionf::exp(sol * 0.1f).toDCM()), 1e-6f);
+    Er = vector3f::hat(sol * 5.0f).expm();
+    check("expm scaled", maxDiff(Er, vector3f::Quaternionf::exp(sol * 5.0f).toDCM()), 1e-5f);
+    // Double integrator has a closed form discretization
+    const float kDi[4] = {0.0f, 1.0f, 0.0f, 0.0f}, kDb[2] = {0.0f, 1.0f}, kDq[4] = {0.0f, 0.0f, 0.0f, 2.0f};
+    const float ts = 0.1f;
+    const float kDf[4] = {1.0f, ts, 0.0f, 1.0f}, kDbd[2] = {0.5f * ts * ts, ts};
+    const float kDqd[4] = {2.0f * ts * ts * ts / 3.0f, ts * ts, ts * ts, 2.0f * ts};
+    matrixf::DiscreteModel<2, 1> dm(matrixf::Matrixf<2, 2>(kDi), matrixf::Matrixf<2, 1>(kDb),
+                                    matrixf::Matrixf<2, 2>(kDq), ts);
+    check("c2d van loan", maxDiff(dm.F(), matrixf::Matrixf<2, 2>(kDf)) +
+                          maxDiff(dm.B(), matrixf::Matrixf<2, 1>(kDbd)) +
+                          maxDiff(dm.Q(), matrixf::Matrixf<2, 2>(kDqd)), 1e-6f);
+
+    // Forward differentiation against the analytic Jacobian
+    const float xa[3] = {0.3f, -1.2f, 2.0f};
+    float ya[2];
+    matrixf::Matrixf<2, 3> Ja;
+    matrixf::jacobian<2, 3>([](const auto *v, auto *r) {
+        r[0] = sin(v[0]) * v[1] + 2 * v[2];
+        r[1] = atan2(v[1], v[2]) / sqrt(v[0] * v[0] + 1.0f);
+    }, xa, ya, Ja);
+    float sa = std::sqrt(xa[0] * xa[0] + 1.0f), ra = xa[1] * xa[1] + xa[2] * xa[2], ta = std::atan2(xa[1], xa[2]);
+    const float kJa[6] = {std::cos(xa[0]) * xa[1], std::sin(xa[0]), 2.0f,
+                          -ta * xa[0] / (sa * sa * sa), xa[2] / ra / sa, -xa[1] / ra / sa};
+    check("dual jacobian", maxDiff(Ja, matrixf::Matrixf<2, 3>(kJa)) +
+                           std::fabs(ya[0] - (std::sin(xa[0]) * xa[1] + 2 * xa[2])) + std::fabs(ya[1] - ta / sa), 1e-6f);
+
+    // Batch kernels against one matrix at a time, 19 slots leave a scalar tail
+    matrixf::MatrixBatch<3, 3, 19> ba, bb, bi3;
+    matrixf::MatrixBatch<5, 5, 19> b5, bi5;
+    matrixf::MatrixBatch<2, 2, 19> b2, bi2;
+    for (uint32_t b = 0; b < 19; b++) {
+        matrixf::Matrixf<3, 3> m3;
+        matrixf::Matrixf<5, 5> m5;
+        matrixf::Matrixf<2, 2> m2;
+        fill(m3, 0.1f * (float) b);
+        ba.set(b, m3);
+        fill(m3, 0.3f + 0.2f * (float) b);
+        bb.set(b, m3);
+        fill(m5, 0.5f * (float) b);
+        b5.set(b, m5);
+        fill(m2, 0.7f * (float) b);
+        b2.set(b, m2);
+    }
+    matrixf::MatrixBatch<3, 3, 19> bm = ba * bb.transpose() + ba;
+    uint8_t berr = ba.inverse(bi3) | b5.inverse(bi5) | b2.inverse(bi2);
+    err = berr;
+    for (uint32_t b = 0; b < 19; b++) {
+        matrixf::Matrixf<3, 3> ref = ba.get(b) * bb.get(b).transpose() + ba.get(b);
+        err = std::fmax(err, maxDiff(bm.get(b), ref));
+        err = std::fmax(err, maxDiff(bi3.get(b), ba.get(b).inverse()));
+        err = std::fmax(err, maxDiff(bi5.get(b), b5.get(b).inverse()));
+        err = std::fmax(err, maxDiff(bi2.get(b), b2.get(b).inverse()));
+    }
+    check("batch mult/add/trans/inverse", err, 1e-4f);
+
+    // Fixed point against float, inputs scaled so that the product stays in [-1, 1)
+    matrixf::Matrixf<6, 6> fa, fb;
+    fill(fa, 0.2f);
+    fill(fb, 0.6f);
+    fa *= 0.15f;
+    fb *= 0.15f;
+    matrixf::Matrixf<6, 6> fref = fa * fb.transpose() + fa - fb;
+    matrixf::Matrixq31<6, 6> qa(fa), qb(fb);
+    matrixf::Matrixq15<6, 6> ha(fa), hb(fb);
+    check("q31 mult/add/sub/trans", maxDiff((qa * qb.transpose() + qa - qb).toFloat(), fref), 1e-6f);
+    check("q15 mult/add/sub/trans", maxDiff((ha * hb.transpose() + ha - hb).toFloat(), fref), 5e-4f);
+    matrixf::Matrixq15<6, 6> hs = (ha.scale(matrixf::qFromFloat<int16_t>(0.5f), 1) - hb * hb) * matrixf::qFromFloat<int16_t>(-0.25f);
+    check("q15 scale", maxDiff(hs.toFloat(), matrixf::Matrixf<6, 6>((fa - fb * fb) * -0.25f)), 5e-4f);
+    matrixf::Matrixq31<6, 6> qsat = qa.scale(matrixf::qFromFloat<int32_t>(0.5f), 8) + qa.scale(matrixf::qFromFloat<int32_t>(0.5f), 8);
+    err = 0;
+    for (uint32_t i = 0; i < 36; i++) {
+        float v = 256.0f * fa.data()[i];
+        err = std::fmax(err, std::fabs(qsat.toFloat().data()[i] - std::fmax(-1.0f, std::fmin(1.0f, v))));
+    }
+    // The sums of 6 products of 0.5 are out of range, they saturate on every backend
+    matrixf::Matrixq31<6, 6> qbig;
+    for (uint32_t i = 0; i < 36; i++) { qbig.data()[i] = matrixf::qFromFloat<int32_t>(0.5f); }
+    matrixf::Matrixq31<6, 6> qsum = qbig * qbig;
+    for (uint32_t i = 0; i < 36; i++) { err = std::fmax(err, std::fabs(qsum.toFloat().data()[i] - 1.0f)); }
+    check("q31 saturation", err, 1e-6f);
+
+    matrixf::Matrixf<3, 1> x, y;
+    fill(x, 0.1f);
+    fill(y, 0.9f);
+    matrixf::Matrixf<3, 1> c = vector3f::cross(x, y);
+    check("cross orthogonality", std::fabs((c.transpose() * x)(0, 0)) + std::fabs((c.transpose() * y)(0, 0)));
+
+    // Quaternion kernels against the DCM
+    matrixf::Matrixf<3, 1> phi0, phi1;
+    fill(phi0, 0.4f);
+    fill(phi1, 1.9f);
+    phi0 *= 0.4f;
+    vector3f::Quaternionf q0 = vector3f::Quaternionf::exp(phi0), q1 = vector3f::Quaternionf::exp(phi1);
+    vector3f::Quaternionf q01 = q0 * q1;
+    check("quat rotate/product vs DCM", maxDiff(q01.rotate(x), matrixf::Matrixf<3, 1>(q0.toDCM() * q1.toDCM() * x)));
+    check("quat exp/log", maxDiff(q0.log(), phi0) + maxDiff(vector3f::Quaternionf::exp(phi0 * 1e-5f).log(),
+                                                          matrixf::Matrixf<3, 1>(phi0 * 1e-5f)), 1e-5f);
+    vector3f::Quaternionf qd = vector3f::Quaternionf::fromDCM(q01.toDCM());
+    check("quat from DCM", std::fabs(std::fabs(qd.dot(q01)) - 1.0f), 1e-6f);
+    // Half turns about multi-axis axes, w is 0 and the signs come from the off-diagonal
+    const float kSwap[9] = {0, -1, 0, -1, 0, 0, 0, 0, -1};
+    matrixf::Matrixf<3, 3> swap(kSwap);
+    err = maxDiff(vector3f::Quaternionf::fromDCM(swap).toDCM(), swap);
+    matrixf::Matrixf<3, 1> axis;
+    fill(axis, 0.7f);
+    axis *= 3.14159f / axis.norm();
+    vector3f::Quaternionf qpi = vector3f::Quaternionf::exp(axis);
+    err = std::fmax(err, maxDiff(vector3f::Quaternionf::fromDCM(qpi.toDCM()).toDCM(), qpi.toDCM()));
+    check("quat from DCM near pi", err, 1e-5f);
+    vector3f::Quaternionf qh = vector3f::Quaternionf::slerp(q0, q1, 0.5f);
+    check("quat slerp midpoint", maxDiff((qh.conjugate() * q1).log(), (q0.conjugate() * qh).log()), 1e-5f);
+    float vs[12], vx[4], vy[4], vz[4];
+    for (uint32_t i = 0; i < 12; i++) { vs[i] = std::sin(0.3f * (float) i); }
+    for (uint32_t i = 0; i < 4; i++) {
+        vx[i] = vs[3 * i];
+        vy[i] = vs[3 * i + 1];
+        vz[i] = vs[3 * i + 2];
+    }
+    q01.rotate(vx, vy, vz, vx, vy, vz, 4);
+    q01.rotate(vs, vs, 4);
+    err = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        err = std::fmax(err, std::fabs(vs[3 * i] - vx[i]) + std::fabs(vs[3 * i + 1] - vy[i]) + std::fabs(vs[3 * i + 2] - vz[i]));
+    }
+    check("quat batch rotate", err);
+
+    printf("%s\n", failed ? "Some tests failed" : "All tests passed");
+    return failed ? 1 : 0;
+}
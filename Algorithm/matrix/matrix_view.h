@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ * @file    matrix_view.h
+ * @brief   Non-owning views into Matrixf storage.
+ *          Blocks, rows, columns and the diagonal are read and written in
+ *          place, without copying into a temporary Matrixf.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Usage:
+ *      P.block<3, 3>(0, 3) = P.block<3, 3>(0, 3) * 0.5f;
+ *      P.diagonal() += q;
+ *      x = A * P.col(2);
+ *
+ * A view is an expression of matrix_expr.h, it can be an operand anywhere a
+ * Matrixf can, and the left side of =, +=, -=, *= and /=. Element (i,j) is
+ * data[i*_stride+j], so the diagonal is a column with stride cols+1.
+ * A view keeps a pointer to the matrix, it must not outlive it. Views of a
+ * const matrix are read only.
+ */
+
+#ifndef MATRIX_VIEW_H
+#define MATRIX_VIEW_H
+
+#include <cstdint>
+
+#include "matrix_expr.h"
+
+namespace matrixf {
+
+    template<uint32_t _rows, uint32_t _cols, uint32_t _stride, typename T>
+    class MatrixView : public MatrixExpr<MatrixView<_rows, _cols, _stride, T>> {
+    protected:
+        T *data_;
+
+    public:
+        static constexpr uint32_t kRows = _rows;
+        static constexpr uint32_t kCols = _cols;
+        static constexpr bool kDirect = true;
+
+        explicit MatrixView(T *data) : data_(data) {}
+
+        MatrixView(const MatrixView &view) = default;
+
+        uint32_t rows() const { return _rows; }
+
+        uint32_t cols() const { return _cols; }
+
+        T &operator()(const uint32_t &row, const uint32_t &col) const { return data_[row * _stride + col]; }
+
+        MATRIX_INLINE float coeff(uint32_t row, uint32_t col) const { return data_[row * _stride + col]; }
+
+        bool overlaps(const ExprDst &d) const { return d.overlaps(data_, data_ + (_rows - 1) * _stride + _cols); }
+
+        bool aliases(const ExprDst &d) const { return d.aliases(data_, data_ + (_rows - 1) * _stride + _cols, _stride); }
+
+        // Sub views
+        template<uint32_t rows, uint32_t cols>
+        MatrixView<rows, cols, _stride, T> block(const uint32_t &row, const uint32_t &col) const {
+            static_assert(rows <= _rows && cols <= _cols, "Block out of range");
+            return MatrixView<rows, cols, _stride, T>(data_ + row * _stride + col);
+        }
+
+        MatrixView<1, _cols, _stride, T> row(const uint32_t &row) const {
+            return MatrixView<1, _cols, _stride, T>(data_ + row * _stride);
+        }
+
+        MatrixView<_rows, 1, _stride, T> col(const uint32_t &col) const {
+            return MatrixView<_rows, 1, _stride, T>(data_ + col);
+        }
+
+        TransposeExpr<MatrixView> transpose() const { return TransposeExpr<MatrixView>(*this); }
+
+        /*Assignment writes through to the viewed matrix*/
+        MatrixView &operator=(const MatrixView &view) {
+            assignTo(data_, _stride, view);
+            return *this;
+        }
+
+        template<typename E>
+        MatrixView &operator=(const MatrixExpr<E> &e) {
+            static_assert(E::kRows == _rows && E::kCols == _cols, "Matrix size mismatch");
+            assignTo(data_, _stride, e.derived());
+            return *this;
+        }
+
+        template<typename E>
+        MatrixView &operator+=(const MatrixExpr<E> &e) { return *this = *this + e.derived(); }
+
+        template<typename E>
+        MatrixView &operator-=(const MatrixExpr<E> &e) { return *this = *this - e.derived(); }
+
+        template<typename E>
+        MatrixView &operator*=(const MatrixExpr<E> &e) { return *this = *this * e.derived(); }
+
+        MatrixView &operator*=(const float &val) { return *this = *this * val; }
+
+        MatrixView &operator/=(const float &val) { return *this = *this * (1.f / val); }
+    };
+
+}  // namespace matrixf
+
+#endif  // MATRIX_VIEW_H
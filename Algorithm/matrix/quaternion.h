@@ -0,0 +1,249 @@
+/**
+ ******************************************************************************
+ * @file    quaternion.h
+ * @brief   Unit quaternion and SO(3) kernels of vector3f.
+ *          Product, rotation, exp/log maps, DCM conversion and slerp, all
+ *          without data dependent branches.
+ ******************************************************************************
+ * @date    2026/10/17
+ * @author  qianwan.Jin
+ * @version 1.0
+ * @stepper 0.0
+ * *****************************************************************************
+ */
+
+/**
+ * Hamilton convention, scalar first q = [w, x, y, z] like the state of
+ * EKF::cEKF. rotate(v) maps a body vector to the reference frame,
+ * v_ref = q * v * q^-1, toDCM() is the same rotation as a matrix.
+ * exp() takes a rotation vector (axis * angle) and log() returns one.
+ *
+ * Small angles are handled by ternary selects of a series expansion, which
+ * compile to conditional moves, so the kernels keep a fixed instruction
+ * stream. Batch rotate() works on arrays of vectors with one DCM.
+ */
+
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "matrix.h"
+
+namespace vector3f {
+
+    class Quaternionf {
+    protected:
+        float q_[4];
+
+        // Below this angle sin(a)/a uses its series
+        static constexpr float kSmallAngle = 1e-4f;
+
+    public:
+        // Identity rotation
+        Quaternionf() : q_{1.0f, 0.0f, 0.0f, 0.0f} {}
+
+        Quaternionf(float w, float x, float y, float z) : q_{w, x, y, z} {}
+
+        // From [w, x, y, z]
+        explicit Quaternionf(const float *q) : q_{q[0], q[1], q[2], q[3]} {}
+
+        float w() const { return q_[0]; }
+
+        float x() const { return q_[1]; }
+
+        float y() const { return q_[2]; }
+
+        float z() const { return q_[3]; }
+
+        float *data() { return q_; }
+
+        const float *data() const { return q_; }
+
+        float &operator[](const uint32_t &i) { return q_[i]; }
+
+        const float &operator[](const uint32_t &i) const { return q_[i]; }
+
+        // Vector part
+        matrixf::Matrixf<3, 1> vec() const { return matrixf::Matrixf<3, 1>(q_ + 1); }
+
+        // Hamilton product, this rotation after q
+        Quaternionf operator*(const Quaternionf &q) const {
+            return {q_[0] * q.q_[0] - q_[1] * q.q_[1] - q_[2] * q.q_[2] - q_[3] * q.q_[3],
+                    q_[0] * q.q_[1] + q_[1] * q.q_[0] + q_[2] * q.q_[3] - q_[3] * q.q_[2],
+                    q_[0] * q.q_[2] - q_[1] * q.q_[3] + q_[2] * q.q_[0] + q_[3] * q.q_[1],
+                    q_[0] * q.q_[3] + q_[1] * q.q_[2] - q_[2] * q.q_[1] + q_[3] * q.q_[0]};
+        }
+
+        Quaternionf &operator*=(const Quaternionf &q) { return *this = *this * q; }
+
+        // Inverse of a unit quaternion
+        Quaternionf conjugate() const { return {q_[0], -q_[1], -q_[2], -q_[3]}; }
+
+        float dot(const Quaternionf &q) const {
+            return q_[0] * q.q_[0] + q_[1] * q.q_[1] + q_[2] * q.q_[2] + q_[3] * q.q_[3];
+        }
+
+        float norm() const { return std::sqrt(dot(*this)); }
+
+        void normalize() {
+            float inv = 1.0f / norm();
+            for (float &v: q_) { v *= inv; }
+        }
+
+        Quaternionf normalized() const {
+            Quaternionf res(*this);
+            res.normalize();
+            return res;
+        }
+
+        /**
+         * q * v * q^-1 of a unit quaternion, 15 multiplies.
+         * t = 2 * u x v, v' = v + w * t + u x t, u the vector part
+         */
+        void rotate(const float *v, float *dst) const {
+            float tx = 2.0f * (q_[2] * v[2] - q_[3] * v[1]);
+            float ty = 2.0f * (q_[3] * v[0] - q_[1] * v[2]);
+            float tz = 2.0f * (q_[1] * v[1] - q_[2] * v[0]);
+            float rx = v[0] + q_[0] * tx + q_[2] * tz - q_[3] * ty;
+            float ry = v[1] + q_[0] * ty + q_[3] * tx - q_[1] * tz;
+            float rz = v[2] + q_[0] * tz + q_[1] * ty - q_[2] * tx;
+            dst[0] = rx;
+            dst[1] = ry;
+            dst[2] = rz;
+        }
+
+        matrixf::Matrixf<3, 1> rotate(const matrixf::Matrixf<3, 1> &v) const {
+            matrixf::Matrixf<3, 1> res;
+            rotate(v.data(), res.data());
+            return res;
+        }
+
+        // Rotate n vectors stored as rows [x0,y0,z0,x1,...] with one DCM, dst may be v
+        void rotate(const float *v, float *dst, uint32_t n) const {
+            matrixf::Matrixf<3, 3> r(toDCM());
+            for (uint32_t i = 0; i < n; i++) {
+                const float *p = v + 3 * i;
+                float rx = r(0, 0) * p[0] + r(0, 1) * p[1] + r(0, 2) * p[2];
+                float ry = r(1, 0) * p[0] + r(1, 1) * p[1] + r(1, 2) * p[2];
+                float rz = r(2, 0) * p[0] + r(2, 1) * p[1] + r(2, 2) * p[2];
+                dst[3 * i] = rx;
+                dst[3 * i + 1] = ry;
+                dst[3 * i + 2] = rz;
+            }
+        }
+
+        // Rotate n vectors stored as separate x, y, z arrays, the loop vectorizes
+        void rotate(const float *x, const float *y, const float *z, float *dx, float *dy, float *dz,
+                    uint32_t n) const {
+            matrixf::Matrixf<3, 3> r(toDCM());
+            const float r00 = r(0, 0), r01 = r(0, 1), r02 = r(0, 2);
+            const float r10 = r(1, 0), r11 = r(1, 1), r12 = r(1, 2);
+            const float r20 = r(2, 0), r21 = r(2, 1), r22 = r(2, 2);
+            for (uint32_t i = 0; i < n; i++) {
+                float vx = x[i], vy = y[i], vz = z[i];
+                dx[i] = r00 * vx + r01 * vy + r02 * vz;
+                dy[i] = r10 * vx + r11 * vy + r12 * vz;
+                dz[i] = r20 * vx + r21 * vy + r22 * vz;
+            }
+        }
+
+        // Rotation matrix of a unit quaternion, v_ref = R * v
+        matrixf::Matrixf<3, 3> toDCM() const {
+            const float w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+            const float xx = x * x, yy = y * y, zz = z * z;
+            const float xy = x * y, xz = x * z, yz = y * z, wx = w * x, wy = w * y, wz = w * z;
+            const float r[9] = {1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy),
+                                2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx),
+                                2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy)};
+            return matrixf::Matrixf<3, 3>(r);
+        }
+
+        /**
+         * Unit quaternion of a rotation matrix, w >= 0.
+         * The largest of w, x, y, z comes from the diagonal and the others from
+         * the off-diagonal sums and differences divided by it, so the signs
+         * stay right near a half turn where w goes to 0.
+         */
+        static Quaternionf fromDCM(const matrixf::Matrixf<3, 3> &r) {
+            const float r00 = r(0, 0), r11 = r(1, 1), r22 = r(2, 2), t = r00 + r11 + r22;
+            float w, x, y, z;
+            if (t >= r00 && t >= r11 && t >= r22) {
+                float s = 2.0f * std::sqrt(1.0f + t);   // 4w
+                w = 0.25f * s;
+                x = (r(2, 1) - r(1, 2)) / s;
+                y = (r(0, 2) - r(2, 0)) / s;
+                z = (r(1, 0) - r(0, 1)) / s;
+            } else if (r00 >= r11 && r00 >= r22) {
+                float s = 2.0f * std::sqrt(1.0f + r00 - r11 - r22);   // 4x
+                w = (r(2, 1) - r(1, 2)) / s;
+                x = 0.25f * s;
+                y = (r(0, 1) + r(1, 0)) / s;
+                z = (r(0, 2) + r(2, 0)) / s;
+            } else if (r11 >= r22) {
+                float s = 2.0f * std::sqrt(1.0f - r00 + r11 - r22);   // 4y
+                w = (r(0, 2) - r(2, 0)) / s;
+                x = (r(0, 1) + r(1, 0)) / s;
+                y = 0.25f * s;
+                z = (r(1, 2) + r(2, 1)) / s;
+            } else {
+                float s = 2.0f * std::sqrt(1.0f - r00 - r11 + r22);   // 4z
+                w = (r(1, 0) - r(0, 1)) / s;
+                x = (r(0, 2) + r(2, 0)) / s;
+                y = (r(1, 2) + r(2, 1)) / s;
+                z = 0.25f * s;
+            }
+            float sign = w < 0.0f ? -1.0f : 1.0f;
+            Quaternionf res(sign * w, sign * x, sign * y, sign * z);
+            res.normalize();
+            return res;
+        }
+
+        // Rotation by the angle |phi| about phi
+        static Quaternionf exp(const matrixf::Matrixf<3, 1> &phi) {
+            float a2 = phi(0, 0) * phi(0, 0) + phi(1, 0) * phi(1, 0) + phi(2, 0) * phi(2, 0);
+            float a = std::sqrt(a2);
+            // sin(a/2)/a
+            float k = a > kSmallAngle ? std::sin(0.5f * a) / a : 0.5f - a2 * (1.0f / 48.0f);
+            return {std::cos(0.5f * a), k * phi(0, 0), k * phi(1, 0), k * phi(2, 0)};
+        }
+
+        // Rotation vector of a unit quaternion, the angle is within [0, pi]
+        matrixf::Matrixf<3, 1> log() const {
+            // q and -q are the same rotation, take the one with w >= 0
+            float s = std::copysign(1.0f, q_[0]);
+            float w = s * q_[0];
+            float v = std::sqrt(q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
+            // angle / |u|, the series is 2/w * (1 - v^2 / (3w^2))
+            float k = v > kSmallAngle ? 2.0f * std::atan2(v, w) / v : (2.0f / w) * (1.0f - v * v / (3.0f * w * w));
+            k *= s;
+            matrixf::Matrixf<3, 1> res;
+            res(0, 0) = k * q_[1];
+            res(1, 0) = k * q_[2];
+            res(2, 0) = k * q_[3];
+            return res;
+        }
+
+        // Shortest path interpolation, t in [0, 1]
+        static Quaternionf slerp(const Quaternionf &q0, const Quaternionf &q1, float t) {
+            float d = q0.dot(q1);
+            float s = std::copysign(1.0f, d);
+            d = std::fmin(s * d, 1.0f);
+            float theta = std::acos(d);
+            float sin_theta = std::sin(theta);
+            // Nearly equal rotations fall back to linear weights
+            bool small = sin_theta < kSmallAngle;
+            float k0 = small ? 1.0f - t : std::sin((1.0f - t) * theta) / sin_theta;
+            float k1 = small ? t : std::sin(t * theta) / sin_theta;
+            k1 *= s;
+            Quaternionf res(k0 * q0.q_[0] + k1 * q1.q_[0], k0 * q0.q_[1] + k1 * q1.q_[1],
+                            k0 * q0.q_[2] + k1 * q1.q_[2], k0 * q0.q_[3] + k1 * q1.q_[3]);
+            res.normalize();
+            return res;
+        }
+    };
+
+}  // namespace vector3f
+
+#endif  // QUATERNION_H